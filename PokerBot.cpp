@@ -7,12 +7,511 @@
 #include <iomanip>
 #include <ctime>
 #include <limits>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <functional>
+#include <numeric>
+#include <unordered_map>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define POKERBOT_HAS_MMAP 1
+#endif
+#if defined(__linux__)
+#include <csignal>
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#define POKERBOT_HAS_IO_URING 1
+#endif
 
 // Constants
 const int DECK_SIZE = 52;
 const int SIMULATION_TIME_LIMIT_MS = 10000; 
 const double WIN_PROBABILITY_THRESHOLD = 0.5; 
 const double UCB1_CONSTANT = 1.41421356237; 
+const int ISMCTS_MAX_NODES = 4000000;      // default node budget of an ISMCTS tree
+const double ISMCTS_PRUNE_FRACTION = 0.25; // share of the budget freed when it is reached
+const int ISMCTS_ITERATION_NODES = 3;      // most nodes one iteration adds: an action pair and a chance child
+const int BOOK_MIN_VISITS = 64;            // information sets visited less are left out of the book
+const int BOOK_PRIOR_VISITS = 20000;       // most root visits a seeded book tree counts for
+const double WIDENING_COEFFICIENT = 2.0;   // chance node with n visits keeps at most ceil(C * n^alpha) children
+const double WIDENING_EXPONENT = 0.5;
+const int POLICY_STRENGTH_BUCKETS = 5;     // rollout policy hand-strength buckets
+const int POLICY_POT_ODDS_BUCKETS = 4;     // rollout policy price-to-call buckets
+const double DEFAULT_POT_ODDS = 0.25;      // call / (pot + call) faced by opponents in rollouts
+const int LEAF_FEATURES = 17;              // leaf evaluator inputs
+const int LEAF_INPUT_STRIDE = 32;          // inputs padded to one AVX2 register of int8
+const int LEAF_HIDDEN = 32;
+const int LEAF_ROLLOUTS_PER_SAMPLE = 2000; // rollouts averaged into each self-play training target
+const int LEAF_TRAINING_EPOCHS = 40;
+const int ALLIN_EV_SAMPLES = 1000000;      // showdowns per --allin-ev run
+const int BENCH_REPETITIONS = 15;          // timed runs per benchmark
+const double BENCH_DEFAULT_THRESHOLD_PCT = 5.0;   // median slowdown that counts as a regression
+const double BENCH_SIGNIFICANCE = 0.01;    // two-sided Mann-Whitney p-value for a real change
+const double BENCH_NOISE_MADS = 3.0;       // median change below this many pooled robust sigmas is noise
+const int TRACE_BUFFER_CAPACITY = 65536;   // events kept per thread (oldest overwritten)
+const int TRACE_CHUNK_SIMULATIONS = 4096;  // simulations per traced chunk
+const int DEADLINE_MISS_TOLERANCE_MS = 5;  // wall-clock overrun that counts as a missed deadline
+const int METRICS_DEFAULT_INTERVAL_MS = 1000;
+const int COMBO_COUNT = 1326;               // two-card combinations from 52 cards
+const int TIME_CHECK_INTERVAL = 64;         // simulations between deadline checks
+const int STARTING_HAND_CLASSES = 169;      // 13 pairs, 78 suited, 78 offsuit
+const int MAX_OPPONENTS = 8;                // full ring: nine players
+const int MAX_PLAYERS = MAX_OPPONENTS + 1;
+const int MULTIWAY_DEFAULT_SAMPLES = 2000000;
+const int QUERY_CHUNK_SIMULATIONS = 2048;  // simulations a query runs before yielding
+const size_t QUERY_ARENA_BLOCK_BYTES = 1024;
+const size_t QUERY_ARENA_FREE_LIST_MAX = 1024;  // idle arenas kept per thread
+const size_t QUERY_RECYCLE_SIZE_CLASSES = 17;    // executor blocks up to 256 bytes are recycled
+const long long BATCH_DEFAULT_SIMULATIONS = 100000;
+const int BATCH_DEFAULT_DEADLINE_MS = 1000;
+const size_t BATCH_OUTPUT_FLUSH_BYTES = 1 << 16;
+const int SERVER_MAX_CONNECTIONS = 64;      // clients served at once (more are refused)
+const size_t SERVER_BUFFER_BYTES = 1 << 14; // registered input and output buffer per client
+const int HEATMAP_PREFLOP_SAMPLES = 20000;  // random boards for a preflop heatmap
+const int COMPARE_SAMPLES = 20000;          // shared samples per --compare-holdings run
+const int COMPARE_REPETITIONS = 20;         // runs the edge variance is measured over
+
+
+// A completed span for the Chrome trace-event format (chrome://tracing, Perfetto)
+struct TraceEvent {
+    const char* name;
+    long long startUs;
+    long long durationUs;
+    long long arg;
+};
+
+// Fixed-size ring of events written by exactly one thread, so recording needs no locks
+struct TraceBuffer {
+    std::vector<TraceEvent> events;
+    size_t next;
+    bool wrapped;
+    int threadId;
+
+    explicit TraceBuffer(int id) : events(TRACE_BUFFER_CAPACITY), next(0), wrapped(false), threadId(id) {}
+
+    void push(const TraceEvent& event) {
+        events[next] = event;
+        if (++next == events.size()) {
+            next = 0;
+            wrapped = true;
+        }
+    }
+};
+
+// Optional span tracer. When disabled every call is a single branch on a flag.
+class Tracer {
+public:
+    static bool enabled() {
+        return active;
+    }
+
+    static void enable() {
+        epoch();
+        active = true;
+    }
+
+    // Microseconds since tracing was enabled
+    static long long nowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - epoch()).count();
+    }
+
+    static void record(const char* name, long long startUs, long long arg = 0) {
+        if (!active) return;
+        TraceEvent event;
+        event.name = name;
+        event.startUs = startUs;
+        event.durationUs = nowUs() - startUs;
+        event.arg = arg;
+        localBuffer().push(event);
+    }
+
+    // Write all recorded spans as Chrome trace-event JSON. Call once worker threads are idle.
+    static bool writeChromeTrace(const std::string& path) {
+        std::ofstream out(path.c_str());
+        if (!out) return false;
+
+        std::lock_guard<std::mutex> lock(registryMutex());
+        std::vector<TraceBuffer*>& buffers = registry();
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        for (size_t b = 0; b < buffers.size(); ++b) {
+            const TraceBuffer& buffer = *buffers[b];
+            size_t count = buffer.wrapped ? buffer.events.size() : buffer.next;
+            size_t begin = buffer.wrapped ? buffer.next : 0;
+            for (size_t i = 0; i < count; ++i) {
+                const TraceEvent& event = buffer.events[(begin + i) % buffer.events.size()];
+                out << (first ? "" : ",") << "\n{\"name\":\"" << event.name
+                    << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.threadId
+                    << ",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs
+                    << ",\"args\":{\"n\":" << event.arg << "}}";
+                first = false;
+            }
+        }
+        out << "\n]}\n";
+        return static_cast<bool>(out);
+    }
+
+private:
+    static bool active;
+
+    static std::chrono::steady_clock::time_point epoch() {
+        static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        return start;
+    }
+
+    static std::mutex& registryMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    // Buffers outlive their threads so spans can be exported after workers exit
+    static std::vector<TraceBuffer*>& registry() {
+        static std::vector<TraceBuffer*> buffers;
+        return buffers;
+    }
+
+    static TraceBuffer& localBuffer() {
+        thread_local TraceBuffer* buffer = NULL;
+        if (buffer == NULL) {
+            std::lock_guard<std::mutex> lock(registryMutex());
+            buffer = new TraceBuffer(static_cast<int>(registry().size()) + 1);
+            registry().push_back(buffer);
+        }
+        return *buffer;
+    }
+};
+
+bool Tracer::active = false;
+
+// Records a span covering its own lifetime
+class TraceSpan {
+private:
+    const char* name;
+    long long startUs;
+    long long arg;
+    bool live;
+
+public:
+    explicit TraceSpan(const char* spanName) : name(spanName), startUs(0), arg(0), live(Tracer::enabled()) {
+        if (live) startUs = Tracer::nowUs();
+    }
+
+    void setArg(long long value) {
+        arg = value;
+    }
+
+    ~TraceSpan() {
+        if (live) Tracer::record(name, startUs, arg);
+    }
+};
+
+
+// Counters exported on the metrics page
+enum MetricCounter {
+    METRIC_SIMULATIONS = 0,
+    METRIC_DECISIONS,
+    METRIC_DEADLINE_MISSES,
+    METRIC_CACHE_HITS,
+    METRIC_CACHE_MISSES,
+    METRIC_COALESCED_QUERIES,
+    METRIC_COUNTER_COUNT
+};
+
+// Streets for per-street decision latency
+enum Street {
+    STREET_PREFLOP = 0,
+    STREET_FLOP,
+    STREET_TURN,
+    STREET_RIVER,
+    STREET_COUNT
+};
+
+// Latency histogram bucket upper bounds in milliseconds (last bucket is +Inf)
+const int METRIC_LATENCY_BUCKETS = 10;
+const double METRIC_LATENCY_BOUNDS_MS[METRIC_LATENCY_BUCKETS] = {
+    1, 5, 10, 50, 100, 500, 1000, 5000, 10000, 20000
+};
+
+// Per-thread metric storage. Only the owning thread writes, so updates are
+// relaxed load/store pairs; readers aggregate across shards on demand.
+struct MetricShard {
+    std::atomic<unsigned long long> counters[METRIC_COUNTER_COUNT];
+    std::atomic<unsigned long long> latencyBuckets[STREET_COUNT][METRIC_LATENCY_BUCKETS + 1];
+    std::atomic<unsigned long long> latencySumUs[STREET_COUNT];
+
+    MetricShard() {
+        for (int i = 0; i < METRIC_COUNTER_COUNT; i++) counters[i].store(0);
+        for (int s = 0; s < STREET_COUNT; s++) {
+            for (int b = 0; b <= METRIC_LATENCY_BUCKETS; b++) latencyBuckets[s][b].store(0);
+            latencySumUs[s].store(0);
+        }
+    }
+};
+
+class Metrics {
+public:
+    static void add(MetricCounter counter, unsigned long long amount = 1) {
+        bump(localShard().counters[counter], amount);
+    }
+
+    static void observeLatency(Street street, double ms) {
+        MetricShard& shard = localShard();
+        int bucket = 0;
+        while (bucket < METRIC_LATENCY_BUCKETS && ms > METRIC_LATENCY_BOUNDS_MS[bucket]) {
+            bucket++;
+        }
+        bump(shard.latencyBuckets[street][bucket], 1);
+        bump(shard.latencySumUs[street], static_cast<unsigned long long>(ms * 1000.0));
+    }
+
+    // Gauge set by the most recent decision
+    static void setSimulationsPerSecond(double rate) {
+        simulationsPerSecond().store(rate, std::memory_order_relaxed);
+    }
+
+    // Queries waiting in or running on any executor
+    static void addQueueDepth(long long delta) {
+        queueDepth().fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    // Sum every shard and render a Prometheus text exposition page
+    static std::string renderPrometheus() {
+        unsigned long long counters[METRIC_COUNTER_COUNT] = {0};
+        unsigned long long buckets[STREET_COUNT][METRIC_LATENCY_BUCKETS + 1] = {{0}};
+        unsigned long long sumUs[STREET_COUNT] = {0};
+        {
+            std::lock_guard<std::mutex> lock(registryMutex());
+            std::vector<MetricShard*>& shards = registry();
+            for (size_t i = 0; i < shards.size(); ++i) {
+                for (int c = 0; c < METRIC_COUNTER_COUNT; c++) {
+                    counters[c] += shards[i]->counters[c].load(std::memory_order_relaxed);
+                }
+                for (int st = 0; st < STREET_COUNT; st++) {
+                    for (int b = 0; b <= METRIC_LATENCY_BUCKETS; b++) {
+                        buckets[st][b] += shards[i]->latencyBuckets[st][b].load(std::memory_order_relaxed);
+                    }
+                    sumUs[st] += shards[i]->latencySumUs[st].load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        std::ostringstream out;
+        out << "# TYPE pokerbot_simulations_total counter\n"
+            << "pokerbot_simulations_total " << counters[METRIC_SIMULATIONS] << "\n"
+            << "# TYPE pokerbot_decisions_total counter\n"
+            << "pokerbot_decisions_total " << counters[METRIC_DECISIONS] << "\n"
+            << "# TYPE pokerbot_deadline_misses_total counter\n"
+            << "pokerbot_deadline_misses_total " << counters[METRIC_DEADLINE_MISSES] << "\n"
+            << "# TYPE pokerbot_cache_hits_total counter\n"
+            << "pokerbot_cache_hits_total " << counters[METRIC_CACHE_HITS] << "\n"
+            << "# TYPE pokerbot_cache_misses_total counter\n"
+            << "pokerbot_cache_misses_total " << counters[METRIC_CACHE_MISSES] << "\n"
+            << "# TYPE pokerbot_coalesced_queries_total counter\n"
+            << "pokerbot_coalesced_queries_total " << counters[METRIC_COALESCED_QUERIES] << "\n"
+            << "# TYPE pokerbot_simulations_per_second gauge\n"
+            << "pokerbot_simulations_per_second "
+            << simulationsPerSecond().load(std::memory_order_relaxed) << "\n"
+            << "# TYPE pokerbot_queue_depth gauge\n"
+            << "pokerbot_queue_depth " << queueDepth().load(std::memory_order_relaxed) << "\n"
+            << "# TYPE pokerbot_decision_latency_ms histogram\n";
+        static const char* streetNames[STREET_COUNT] = { "preflop", "flop", "turn", "river" };
+        for (int st = 0; st < STREET_COUNT; st++) {
+            unsigned long long cumulative = 0;
+            for (int b = 0; b <= METRIC_LATENCY_BUCKETS; b++) {
+                cumulative += buckets[st][b];
+                out << "pokerbot_decision_latency_ms_bucket{street=\"" << streetNames[st] << "\",le=\"";
+                if (b < METRIC_LATENCY_BUCKETS) {
+                    out << METRIC_LATENCY_BOUNDS_MS[b];
+                } else {
+                    out << "+Inf";
+                }
+                out << "\"} " << cumulative << "\n";
+            }
+            out << "pokerbot_decision_latency_ms_sum{street=\"" << streetNames[st] << "\"} "
+                << (sumUs[st] / 1000.0) << "\n"
+                << "pokerbot_decision_latency_ms_count{street=\"" << streetNames[st] << "\"} "
+                << cumulative << "\n";
+        }
+        return out.str();
+    }
+
+    // Replace the file atomically so scrapers never see a partial page
+    static bool writePrometheus(const std::string& path) {
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream out(tempPath.c_str());
+            if (!out) return false;
+            out << renderPrometheus();
+            if (!out) return false;
+        }
+        return std::rename(tempPath.c_str(), path.c_str()) == 0;
+    }
+
+private:
+    static void bump(std::atomic<unsigned long long>& value, unsigned long long amount) {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    static std::atomic<double>& simulationsPerSecond() {
+        static std::atomic<double> rate(0.0);
+        return rate;
+    }
+
+    static std::atomic<long long>& queueDepth() {
+        static std::atomic<long long> depth(0);
+        return depth;
+    }
+
+    static std::mutex& registryMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::vector<MetricShard*>& registry() {
+        static std::vector<MetricShard*> shards;
+        return shards;
+    }
+
+    static MetricShard& localShard() {
+        thread_local MetricShard* shard = NULL;
+        if (shard == NULL) {
+            std::lock_guard<std::mutex> lock(registryMutex());
+            shard = new MetricShard();
+            registry().push_back(shard);
+        }
+        return *shard;
+    }
+};
+
+// Background thread that rewrites the metrics page at a fixed interval
+class MetricsExporter {
+private:
+    std::string path;
+    int intervalMs;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            wake.wait_for(lock, std::chrono::milliseconds(intervalMs));
+            Metrics::writePrometheus(path);
+        }
+    }
+
+public:
+    MetricsExporter() : intervalMs(METRICS_DEFAULT_INTERVAL_MS), stopping(false) {}
+
+    ~MetricsExporter() {
+        stop();
+    }
+
+    void start(const std::string& outputPath, int periodMs) {
+        path = outputPath;
+        intervalMs = periodMs;
+        stopping = false;
+        worker = std::thread(&MetricsExporter::run, this);
+    }
+
+    // Stop the thread after one final write
+    void stop() {
+        if (!worker.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+};
+
+
+// Appends lines to a log file from a background thread so callers never block on disk
+class AsyncLineWriter {
+private:
+    std::ofstream out;
+    std::deque<std::string> pending;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+
+    void run() {
+        std::deque<std::string> batch;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this] { return stopping || !pending.empty(); });
+            batch.swap(pending);
+            bool done = stopping;
+            lock.unlock();
+            for (size_t i = 0; i < batch.size(); ++i) {
+                out << batch[i] << '\n';
+            }
+            out.flush();
+            batch.clear();
+            lock.lock();
+            if (done && pending.empty()) break;
+        }
+    }
+
+public:
+    AsyncLineWriter() : stopping(false) {}
+
+    ~AsyncLineWriter() {
+        close();
+    }
+
+    bool open(const std::string& path) {
+        out.open(path.c_str(), std::ios::app);
+        if (!out) return false;
+        stopping = false;
+        worker = std::thread(&AsyncLineWriter::run, this);
+        return true;
+    }
+
+    void write(const std::string& line) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(line);
+        }
+        wake.notify_one();
+    }
+
+    // Drain queued lines and stop the writer thread
+    void close() {
+        if (!worker.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+        out.close();
+    }
+};
 
 
 // Card suits
@@ -206,6 +705,56 @@ struct HandEvaluation {
     }
 };
 
+// Lookup tables over 13-bit rank masks (bit v-2 set for card value v)
+struct RankMaskTables {
+    unsigned char popCount[8192];
+    unsigned char topValue[8192];      // highest value present, 0 for an empty mask
+    unsigned char straightHigh[8192];  // high card of the best straight, 0 if none
+    unsigned char windowCount[8192];   // most values inside one five-value straight window
+
+    RankMaskTables() {
+        for (int mask = 0; mask < 8192; mask++) {
+            int count = 0;
+            int top = 0;
+            for (int bit = 0; bit < 13; bit++) {
+                if (mask & (1 << bit)) {
+                    count++;
+                    top = bit + 2;
+                }
+            }
+            popCount[mask] = static_cast<unsigned char>(count);
+            topValue[mask] = static_cast<unsigned char>(top);
+
+            // Shift so bit 0 is the ace playing low; a run of five bits is a straight
+            int ranks = (mask << 1) | ((mask >> 12) & 1);
+            int runs = ranks & (ranks >> 1) & (ranks >> 2) & (ranks >> 3) & (ranks >> 4);
+            int high = 0;
+            for (int bit = 9; bit >= 0; bit--) {
+                if (runs & (1 << bit)) {
+                    high = bit + 5;
+                    break;
+                }
+            }
+            straightHigh[mask] = static_cast<unsigned char>(high);
+            
+            int most = 0;
+            for (int low = 0; low <= 9; low++) {
+                int inWindow = 0;
+                for (int bit = low; bit < low + 5; bit++) {
+                    inWindow += (ranks >> bit) & 1;
+                }
+                most = std::max(most, inWindow);
+            }
+            windowCount[mask] = static_cast<unsigned char>(most);
+        }
+    }
+
+    static const RankMaskTables& get() {
+        static const RankMaskTables tables;
+        return tables;
+    }
+};
+
 class HandEvaluator {
 public:
     // Evaluate a poker hand (2 hole cards + up to 5 community cards)
@@ -459,9 +1008,12 @@ public:
             evaluation.tiebreakers.push_back(pairs[0]);
             evaluation.tiebreakers.push_back(pairs[1]);
             
-            // Add highest kicker
-            if (!highCards.empty()) {
-                evaluation.tiebreakers.push_back(highCards[0]);
+            // Add highest kicker (a third pair can outrank the unpaired card)
+            for (int i = 14; i >= 2; i--) {
+                if (valueCounts[i] > 0 && i != pairs[0] && i != pairs[1]) {
+                    evaluation.tiebreakers.push_back(i);
+                    break;
+                }
             }
         }
         // One Pair
@@ -494,11 +1046,121 @@ public:
         return evaluation;
     }
     
+    // Pack an evaluation into one int (rank, then up to five 4-bit tiebreakers)
+    // so that integer comparison gives the same ordering as operator>
+    static int packEvaluation(const HandEvaluation& evaluation) {
+        int packed = static_cast<int>(evaluation.rank);
+        for (size_t i = 0; i < 5; i++) {
+            packed = (packed << 4) | (i < evaluation.tiebreakers.size() ? evaluation.tiebreakers[i] : 0);
+        }
+        return packed;
+    }
+    
+    // Rank category of a packed strength
+    static HandRank packedRank(int strength) {
+        return static_cast<HandRank>(strength >> 20);
+    }
+    
+    // Fast path over per-suit rank masks (bit v-2 of suitMasks[s] set for value v of suit s).
+    // Returns the same packed strength as packEvaluation(evaluateComplete(...)).
+    static int evaluateMasks(const int suitMasks[4]) {
+        const RankMaskTables& tables = RankMaskTables::get();
+        int a = suitMasks[0], b = suitMasks[1], c = suitMasks[2], d = suitMasks[3];
+        
+        int flushMask = 0;
+        for (int s = 0; s < 4; s++) {
+            if (tables.popCount[suitMasks[s]] >= 5) {
+                flushMask = suitMasks[s];
+                int high = tables.straightHigh[flushMask];
+                if (high == 14) return pack(ROYAL_FLUSH, 14, 0, 0, 0, 0);
+                if (high) return pack(STRAIGHT_FLUSH, high, 0, 0, 0, 0);
+                break;
+            }
+        }
+        
+        int all = a | b | c | d;
+        int four = a & b & c & d;
+        if (four) {
+            int quad = tables.topValue[four];
+            return pack(FOUR_OF_A_KIND, quad, tables.topValue[all & ~valueBit(quad)], 0, 0, 0);
+        }
+        
+        int threePlus = (a & b & c) | (a & b & d) | (a & c & d) | (b & c & d);
+        int pairsOnly = ((a & b) | (a & c) | (a & d) | (b & c) | (b & d) | (c & d)) & ~threePlus;
+        int trip = tables.topValue[threePlus];
+        if (trip) {
+            int second = tables.topValue[(threePlus & ~valueBit(trip)) | pairsOnly];
+            if (second) return pack(FULL_HOUSE, trip, second, 0, 0, 0);
+        }
+        
+        int top[5];
+        if (flushMask) {
+            topValues(flushMask, 5, top);
+            return pack(FLUSH, top[0], top[1], top[2], top[3], top[4]);
+        }
+        
+        int straight = tables.straightHigh[all];
+        if (straight) return pack(STRAIGHT, straight, 0, 0, 0, 0);
+        
+        if (trip) {
+            topValues(all & ~valueBit(trip), 2, top);
+            return pack(THREE_OF_A_KIND, trip, top[0], top[1], 0, 0);
+        }
+        
+        int highPair = tables.topValue[pairsOnly];
+        if (highPair) {
+            int lowPair = tables.topValue[pairsOnly & ~valueBit(highPair)];
+            if (lowPair) {
+                int kicker = tables.topValue[all & ~valueBit(highPair) & ~valueBit(lowPair)];
+                return pack(TWO_PAIR, highPair, lowPair, kicker, 0, 0);
+            }
+            topValues(all & ~valueBit(highPair), 3, top);
+            return pack(PAIR, highPair, top[0], top[1], top[2], 0);
+        }
+        
+        topValues(all, 5, top);
+        return pack(HIGH_CARD, top[0], top[1], top[2], top[3], top[4]);
+    }
+    
+    // Fast path over card indices (Card::toInt)
+    static int evaluateFast(const int* cardIndices, int count) {
+        int suitMasks[4] = {0, 0, 0, 0};
+        for (int i = 0; i < count; i++) {
+            suitMasks[cardIndices[i] / 13] |= 1 << (cardIndices[i] % 13);
+        }
+        return evaluateMasks(suitMasks);
+    }
+    
+    static int evaluateFast(const std::vector<Card>& cards) {
+        int suitMasks[4] = {0, 0, 0, 0};
+        for (size_t i = 0; i < cards.size(); ++i) {
+            suitMasks[static_cast<int>(cards[i].suit)] |= valueBit(static_cast<int>(cards[i].value));
+        }
+        return evaluateMasks(suitMasks);
+    }
+    
     // Helper function for sorting cards by value in descending order
     static bool compareCardsByValueDesc(const Card& a, const Card& b) {
         return static_cast<int>(a.value) > static_cast<int>(b.value);
     }
     
+    static int valueBit(int value) {
+        return 1 << (value - 2);
+    }
+    
+    static int pack(HandRank rank, int t0, int t1, int t2, int t3, int t4) {
+        return (static_cast<int>(rank) << 20) | (t0 << 16) | (t1 << 12) | (t2 << 8) | (t3 << 4) | t4;
+    }
+    
+    // Highest `count` values of a mask, descending (0 when the mask runs out)
+    static void topValues(int mask, int count, int* out) {
+        const RankMaskTables& tables = RankMaskTables::get();
+        for (int i = 0; i < count; i++) {
+            out[i] = tables.topValue[mask];
+            if (out[i]) mask &= ~valueBit(out[i]);
+        }
+    }
+    
     static std::string handRankToString(HandRank rank) {
         switch (rank) {
             case HIGH_CARD: return "High Card";
@@ -516,6 +1178,70 @@ public:
     }
 };
 
+// Suit pattern of a board
+enum BoardSuits {
+    BOARD_RAINBOW = 0,      // no two cards share a suit
+    BOARD_TWO_TONE,         // some suit repeats, not all one suit
+    BOARD_MONOTONE          // every card one suit
+};
+
+// Cheap board descriptors for caching, bucketing and decisions, computed from the per-suit
+// 13-bit masks with bit operations and RankMaskTables lookups (no loops over cards)
+struct BoardTexture {
+    BoardSuits suits;
+    unsigned char cards;
+    unsigned char maxSuitCount;   // cards in the board's most common suit
+    bool paired;                  // some value appears at least twice
+    bool trips;                   // some value appears at least three times
+    unsigned char connectedness;  // most distinct values in one five-value straight window
+    bool straightPossible;        // two hole cards can complete a straight
+    bool flushPossible;           // two hole cards can complete a flush
+    HandRank nutClass;            // category of the best hand two hole cards can make
+
+    static BoardTexture fromMasks(const int suitMasks[4]) {
+        const RankMaskTables& tables = RankMaskTables::get();
+        int a = suitMasks[0], b = suitMasks[1], c = suitMasks[2], d = suitMasks[3];
+        int counts[4] = {tables.popCount[a], tables.popCount[b], tables.popCount[c], tables.popCount[d]};
+        int all = a | b | c | d;
+        
+        BoardTexture texture;
+        texture.cards = static_cast<unsigned char>(counts[0] + counts[1] + counts[2] + counts[3]);
+        texture.maxSuitCount = static_cast<unsigned char>(
+            std::max(std::max(counts[0], counts[1]), std::max(counts[2], counts[3])));
+        texture.paired = tables.popCount[all] < texture.cards;
+        texture.trips = ((a & b & c) | (a & b & d) | (a & c & d) | (b & c & d)) != 0;
+        texture.connectedness = tables.windowCount[all];
+        texture.straightPossible = texture.cards >= 3 && texture.connectedness >= 3;
+        texture.flushPossible = texture.maxSuitCount >= 3;
+        if (texture.maxSuitCount == texture.cards && texture.cards > 1) {
+            texture.suits = BOARD_MONOTONE;
+        } else if (texture.maxSuitCount > 1) {
+            texture.suits = BOARD_TWO_TONE;
+        } else {
+            texture.suits = BOARD_RAINBOW;
+        }
+        
+        // Nuts: straight flush, then quads on a paired board, flush, straight, else a set
+        bool straightFlush = texture.flushPossible &&
+                             (tables.windowCount[a] >= 3 || tables.windowCount[b] >= 3 ||
+                              tables.windowCount[c] >= 3 || tables.windowCount[d] >= 3);
+        if (texture.cards < 3) {
+            texture.nutClass = texture.cards == 0 ? PAIR : THREE_OF_A_KIND;
+        } else if (straightFlush) {
+            texture.nutClass = STRAIGHT_FLUSH;
+        } else if (texture.paired) {
+            texture.nutClass = FOUR_OF_A_KIND;
+        } else if (texture.flushPossible) {
+            texture.nutClass = FLUSH;
+        } else if (texture.straightPossible) {
+            texture.nutClass = STRAIGHT;
+        } else {
+            texture.nutClass = THREE_OF_A_KIND;
+        }
+        return texture;
+    }
+};
+
 // Poker game simulator
 class PokerGame {
 private:
@@ -615,8 +1341,9 @@ public:
         dealRiver();
     }
     
-    // Determine the winner (true if bot wins, false if opponent wins)
-    bool isWinner() {
+    // Determine the winner (true if bot wins, false if opponent wins).
+    // Optionally reports both players' final hand categories.
+    bool isWinner(HandRank* botRank = NULL, HandRank* opponentRank = NULL) {
         // Make sure all cards are dealt
         completeBoard();
         
@@ -640,6 +1367,8 @@ public:
         // Evaluate hands
         HandEvaluation botEval = HandEvaluator::evaluate(botHand);
         HandEvaluation opponentEval = HandEvaluator::evaluate(opponentHand);
+        if (botRank != NULL) *botRank = botEval.rank;
+        if (opponentRank != NULL) *opponentRank = opponentEval.rank;
         
         // Compare hands (positive result means bot wins)
         return (botEval > opponentEval);
@@ -675,231 +1404,4697 @@ public:
     }
 };
 
-// MCTS node for poker decisions
-class MCTSNode {
+// Opponent actions in rollouts
+enum OpponentAction {
+    OPPONENT_FOLD = 0,
+    OPPONENT_CALL,
+    OPPONENT_RAISE,
+    OPPONENT_ACTION_COUNT
+};
+
+// Table-driven opponent policy for MCTS rollouts. Action probabilities are indexed by
+// hand-strength bucket, street and pot-odds bucket, and each cell is stored as an alias
+// table so a step is one rand() call and a table read.
+class RolloutPolicy {
 private:
-    int wins;
-    int visits;
-    double explorationParameter;
+    struct AliasTable {
+        unsigned short threshold[OPPONENT_ACTION_COUNT];   // keep the column below this (of 65536)
+        unsigned char alias[OPPONENT_ACTION_COUNT];
+    };
     
-public:
-    MCTSNode() : wins(0), visits(0), explorationParameter(UCB1_CONSTANT) {}
+    AliasTable tables[POLICY_STRENGTH_BUCKETS][STREET_COUNT][POLICY_POT_ODDS_BUCKETS];
     
-    void update(bool isWin) {
-        visits++;
-        if (isWin) {
-            wins++;
+    // Vose's alias construction over the three actions
+    static AliasTable buildAlias(const double probabilities[OPPONENT_ACTION_COUNT]) {
+        AliasTable table;
+        double total = 0.0;
+        for (int a = 0; a < OPPONENT_ACTION_COUNT; a++) {
+            total += probabilities[a];
+        }
+        double scaled[OPPONENT_ACTION_COUNT];
+        int small[OPPONENT_ACTION_COUNT];
+        int large[OPPONENT_ACTION_COUNT];
+        int smallCount = 0;
+        int largeCount = 0;
+        for (int a = 0; a < OPPONENT_ACTION_COUNT; a++) {
+            scaled[a] = probabilities[a] * OPPONENT_ACTION_COUNT / total;
+            table.alias[a] = static_cast<unsigned char>(a);
+            if (scaled[a] < 1.0) {
+                small[smallCount++] = a;
+            } else {
+                large[largeCount++] = a;
+            }
+        }
+        while (smallCount > 0 && largeCount > 0) {
+            int low = small[--smallCount];
+            int high = large[--largeCount];
+            table.threshold[low] = static_cast<unsigned short>(scaled[low] * 65535.0);
+            table.alias[low] = static_cast<unsigned char>(high);
+            scaled[high] -= 1.0 - scaled[low];
+            if (scaled[high] < 1.0) {
+                small[smallCount++] = high;
+            } else {
+                large[largeCount++] = high;
+            }
         }
+        while (largeCount > 0) {
+            table.threshold[large[--largeCount]] = 65535;
+        }
+        while (smallCount > 0) {
+            table.threshold[small[--smallCount]] = 65535;
+        }
+        return table;
     }
     
-    double getWinProbability() const {
-        if (visits == 0) return 0.0;
-        return static_cast<double>(wins) / visits;
+public:
+    // Default tables: folds fall with hand strength and rise with the price and street,
+    // and the strongest buckets raise
+    RolloutPolicy() {
+        for (int b = 0; b < POLICY_STRENGTH_BUCKETS; b++) {
+            for (int s = 0; s < STREET_COUNT; s++) {
+                for (int p = 0; p < POLICY_POT_ODDS_BUCKETS; p++) {
+                    double strength = (b + 0.5) / POLICY_STRENGTH_BUCKETS;
+                    double price = (p + 0.5) / (2.0 * POLICY_POT_ODDS_BUCKETS);
+                    double fold = 0.75 - 1.1 * strength + 0.8 * price + 0.05 * s;
+                    fold = std::max(0.02, std::min(0.95, fold));
+                    double raise = std::max(0.0, std::min(0.6, 1.5 * (strength - 0.6))) * (1.0 - fold);
+                    setActionProbabilities(b, static_cast<Street>(s), p, fold, 1.0 - fold - raise, raise);
+                }
+            }
+        }
     }
     
-    int getVisits() const {
-        return visits;
+    // Replace one cell of the tables
+    void setActionProbabilities(int strengthBucket, Street street, int oddsBucket,
+                                double fold, double call, double raise) {
+        double probabilities[OPPONENT_ACTION_COUNT] = {fold, call, raise};
+        tables[strengthBucket][street][oddsBucket] = buildAlias(probabilities);
     }
     
-    int getWins() const {
-        return wins;
+    OpponentAction sample(int strengthBucket, Street street, int oddsBucket) const {
+        const AliasTable& table = tables[strengthBucket][street][oddsBucket];
+        int r = std::rand();
+        int column = r % OPPONENT_ACTION_COUNT;
+        int coin = (r / OPPONENT_ACTION_COUNT) & 0xFFFF;
+        return static_cast<OpponentAction>(coin < table.threshold[column] ? column : table.alias[column]);
     }
     
-    double getUCB1Value(int parentVisits) const {
-        if (visits == 0) {
-            return std::numeric_limits<double>::infinity();
+    // Price to call, call / (pot + call), mapped to its bucket (prices above 0.5 share the last)
+    static int potOddsBucket(double potOdds) {
+        int bucket = static_cast<int>(potOdds * 2.0 * POLICY_POT_ODDS_BUCKETS);
+        return std::max(0, std::min(POLICY_POT_ODDS_BUCKETS - 1, bucket));
+    }
+    
+    // Preflop buckets from pairs, broadways and suited/connected/ace hands; postflop from
+    // the made-hand category on the current board
+    static int strengthBucket(const int hole[2], const int boardMasks[4], int boardSize) {
+        if (boardSize == 0) {
+            int high = std::max(hole[0] % 13, hole[1] % 13);
+            int low = std::min(hole[0] % 13, hole[1] % 13);
+            if (high == low) return high >= NINE - 2 ? 4 : 3;
+            if (low >= TEN - 2) return 2;
+            if (hole[0] / 13 == hole[1] / 13 || high == ACE - 2 || high - low == 1) return 1;
+            return 0;
         }
-        
-        double exploitation = static_cast<double>(wins) / visits;
-        double exploration = explorationParameter * std::sqrt(std::log(parentVisits) / visits);
-        
-        return exploitation + exploration;
+        int hand[4];
+        std::copy(boardMasks, boardMasks + 4, hand);
+        hand[hole[0] / 13] |= 1 << (hole[0] % 13);
+        hand[hole[1] / 13] |= 1 << (hole[1] % 13);
+        HandRank rank = HandEvaluator::packedRank(HandEvaluator::evaluateMasks(hand));
+        return std::min(static_cast<int>(rank), POLICY_STRENGTH_BUCKETS - 1);
     }
 };
 
-// Monte Carlo Tree Search Poker Bot
-class PokerBot {
+// Small MLP (LEAF_FEATURES -> LEAF_HIDDEN ReLU -> sigmoid) that estimates the bot's pot share
+// at an ISMCTS leaf in place of a rollout. Weights are int8 with a float scale per hidden
+// unit; inputs are quantized to 0-127, so the first layer is an int8 dot product (AVX2 when
+// compiled with it, scalar otherwise).
+class LeafEvaluator {
 private:
-    PokerGame game;
-    std::vector<Card> myCards;
-    std::vector<Card> community;
-    
-    // Keep track of runs for statistics
-    int totalRuns;
-    int winningRuns;
-    MCTSNode rootNode;
-    
-public:
-    PokerBot() : totalRuns(0), winningRuns(0) {
-        // Seed the random number generator
-        std::srand(static_cast<unsigned int>(std::time(NULL)));
+    alignas(32) signed char hiddenWeights[LEAF_HIDDEN][LEAF_INPUT_STRIDE];
+    float hiddenScale[LEAF_HIDDEN];     // weight scale / 127 input scale
+    float hiddenBias[LEAF_HIDDEN];
+    signed char outputWeights[LEAF_HIDDEN];
+    float outputScale;
+    float outputBias;
+
+    static signed char quantize(float value, float scale) {
+        int q = static_cast<int>(std::floor(value / scale + 0.5f));
+        return static_cast<signed char>(std::max(-127, std::min(127, q)));
     }
-    
-    // Set the bot's hole cards and any known community cards
-    void setKnownCards(const std::vector<Card>& holeCards, const std::vector<Card>& communityCards) {
+
+    void hiddenSums(const unsigned char* inputs, int* sums) const {
+#ifdef __AVX2__
+        __m256i x = _mm256_load_si256(reinterpret_cast<const __m256i*>(inputs));
+        __m256i ones = _mm256_set1_epi16(1);
+        for (int j = 0; j < LEAF_HIDDEN; j += 8) {
+            __m256i v[8];
+            for (int k = 0; k < 8; k++) {
+                __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(hiddenWeights[j + k]));
+                v[k] = _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones);
+            }
+            // Reduce eight rows of eight partial sums to one vector of eight totals
+            __m256i s01 = _mm256_hadd_epi32(v[0], v[1]);
+            __m256i s23 = _mm256_hadd_epi32(v[2], v[3]);
+            __m256i s45 = _mm256_hadd_epi32(v[4], v[5]);
+            __m256i s67 = _mm256_hadd_epi32(v[6], v[7]);
+            __m256i s0123 = _mm256_hadd_epi32(s01, s23);
+            __m256i s4567 = _mm256_hadd_epi32(s45, s67);
+            __m256i total = _mm256_add_epi32(_mm256_permute2x128_si256(s0123, s4567, 0x20),
+                                             _mm256_permute2x128_si256(s0123, s4567, 0x31));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums + j), total);
+        }
+#else
+        for (int j = 0; j < LEAF_HIDDEN; j++) {
+            int sum = 0;
+            for (int i = 0; i < LEAF_FEATURES; i++) {
+                sum += inputs[i] * hiddenWeights[j][i];
+            }
+            sums[j] = sum;
+        }
+#endif
+    }
+
+public:
+    static const unsigned int FILE_VERSION = 2;   // 2: feature 16, the board's nut class
+
+    LeafEvaluator() : outputScale(0.0f), outputBias(0.0f) {
+        std::memset(hiddenWeights, 0, sizeof(hiddenWeights));
+        std::memset(outputWeights, 0, sizeof(outputWeights));
+        std::fill(hiddenScale, hiddenScale + LEAF_HIDDEN, 0.0f);
+        std::fill(hiddenBias, hiddenBias + LEAF_HIDDEN, 0.0f);
+    }
+
+    // Quantize float weights (hidden[j][i], one row per hidden unit) with a scale per row
+    void setWeights(const std::vector<float>& hidden, const std::vector<float>& hiddenBiases,
+                    const std::vector<float>& output, float bias) {
+        std::memset(hiddenWeights, 0, sizeof(hiddenWeights));
+        for (int j = 0; j < LEAF_HIDDEN; j++) {
+            float largest = 1e-8f;
+            for (int i = 0; i < LEAF_FEATURES; i++) {
+                largest = std::max(largest, std::fabs(hidden[j * LEAF_FEATURES + i]));
+            }
+            float scale = largest / 127.0f;
+            for (int i = 0; i < LEAF_FEATURES; i++) {
+                hiddenWeights[j][i] = quantize(hidden[j * LEAF_FEATURES + i], scale);
+            }
+            hiddenScale[j] = scale / 127.0f;
+            hiddenBias[j] = hiddenBiases[j];
+        }
+        float largest = 1e-8f;
+        for (int j = 0; j < LEAF_HIDDEN; j++) {
+            largest = std::max(largest, std::fabs(output[j]));
+        }
+        outputScale = largest / 127.0f;
+        for (int j = 0; j < LEAF_HIDDEN; j++) {
+            outputWeights[j] = quantize(output[j], outputScale);
+        }
+        outputBias = bias;
+    }
+
+    bool load(const std::string& path) {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        char magic[4];
+        unsigned int version = 0;
+        in.read(magic, 4);
+        in.read(reinterpret_cast<char*>(&version), sizeof(version));
+        if (!in || std::string(magic, 4) != "PFNN" || version != FILE_VERSION) {
+            return false;
+        }
+        in.read(reinterpret_cast<char*>(hiddenWeights), sizeof(hiddenWeights));
+        in.read(reinterpret_cast<char*>(hiddenScale), sizeof(hiddenScale));
+        in.read(reinterpret_cast<char*>(hiddenBias), sizeof(hiddenBias));
+        in.read(reinterpret_cast<char*>(outputWeights), sizeof(outputWeights));
+        in.read(reinterpret_cast<char*>(&outputScale), sizeof(outputScale));
+        in.read(reinterpret_cast<char*>(&outputBias), sizeof(outputBias));
+        return static_cast<bool>(in);
+    }
+
+    bool save(const std::string& path) const {
+        std::ofstream out(path.c_str(), std::ios::binary);
+        unsigned int version = FILE_VERSION;
+        out.write("PFNN", 4);
+        out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        out.write(reinterpret_cast<const char*>(hiddenWeights), sizeof(hiddenWeights));
+        out.write(reinterpret_cast<const char*>(hiddenScale), sizeof(hiddenScale));
+        out.write(reinterpret_cast<const char*>(hiddenBias), sizeof(hiddenBias));
+        out.write(reinterpret_cast<const char*>(outputWeights), sizeof(outputWeights));
+        out.write(reinterpret_cast<const char*>(&outputScale), sizeof(outputScale));
+        out.write(reinterpret_cast<const char*>(&outputBias), sizeof(outputBias));
+        return static_cast<bool>(out);
+    }
+
+    // FNV-1a hash of the quantized model, never 0
+    unsigned long long fingerprint() const {
+        const void* parts[6] = {hiddenWeights, hiddenScale, hiddenBias, outputWeights, &outputScale, &outputBias};
+        size_t sizes[6] = {sizeof(hiddenWeights), sizeof(hiddenScale), sizeof(hiddenBias), sizeof(outputWeights),
+                           sizeof(outputScale), sizeof(outputBias)};
+        unsigned long long hash = 14695981039346656037ULL;
+        for (int p = 0; p < 6; p++) {
+            const unsigned char* bytes = static_cast<const unsigned char*>(parts[p]);
+            for (size_t i = 0; i < sizes[p]; ++i) {
+                hash = (hash ^ bytes[i]) * 1099511628211ULL;
+            }
+        }
+        return hash == 0 ? 1 : hash;
+    }
+
+    // Estimated pot share for a feature vector from features()
+    double evaluate(const float* features) const {
+        alignas(32) unsigned char inputs[LEAF_INPUT_STRIDE] = {0};
+        for (int i = 0; i < LEAF_FEATURES; i++) {
+            float clamped = std::max(0.0f, std::min(1.0f, features[i]));
+            inputs[i] = static_cast<unsigned char>(clamped * 127.0f + 0.5f);
+        }
+        int sums[LEAF_HIDDEN];
+        hiddenSums(inputs, sums);
+        float out = outputBias;
+        for (int j = 0; j < LEAF_HIDDEN; j++) {
+            float hidden = sums[j] * hiddenScale[j] + hiddenBias[j];
+            if (hidden > 0.0f) {
+                out += hidden * outputWeights[j] * outputScale;
+            }
+        }
+        return 1.0 / (1.0 + std::exp(-out));
+    }
+
+    // Situation features, all in [0, 1]: the bot's made hand and holding, the board texture,
+    // the bot's draws, the price to call, the number of opponents and the board's nut class
+    static void features(const int hero[2], const int* board, int boardSize, int opponents, double potOdds,
+                         float* out) {
+        const RankMaskTables& tables = RankMaskTables::get();
+        int boardMasks[4] = {0, 0, 0, 0};
+        for (int i = 0; i < boardSize; i++) {
+            boardMasks[board[i] / 13] |= 1 << (board[i] % 13);
+        }
+        int hand[4];
+        std::copy(boardMasks, boardMasks + 4, hand);
+        hand[hero[0] / 13] |= 1 << (hero[0] % 13);
+        hand[hero[1] / 13] |= 1 << (hero[1] % 13);
+        int strength = HandEvaluator::evaluateMasks(hand);
+        BoardTexture texture = BoardTexture::fromMasks(boardMasks);
+        BoardTexture withHand = BoardTexture::fromMasks(hand);
+        
+        int high = std::max(hero[0] % 13, hero[1] % 13);
+        int low = std::min(hero[0] % 13, hero[1] % 13);
+        int boardTop = tables.topValue[boardMasks[0] | boardMasks[1] | boardMasks[2] | boardMasks[3]] - 2;
+        HandRank rank = HandEvaluator::packedRank(strength);
+        
+        out[0] = rank / 9.0f;
+        out[1] = ((strength >> 16) & 0xF) / 14.0f;
+        out[2] = high / 12.0f;
+        out[3] = low / 12.0f;
+        out[4] = hero[0] / 13 == hero[1] / 13 ? 1.0f : 0.0f;
+        out[5] = high == low ? 1.0f : 0.0f;
+        out[6] = boardSize / 5.0f;
+        out[7] = texture.maxSuitCount / 5.0f;
+        out[8] = withHand.maxSuitCount / 7.0f;
+        out[9] = texture.paired ? 1.0f : 0.0f;
+        out[10] = boardSize > 0 ? HandEvaluator::packedRank(HandEvaluator::evaluateMasks(boardMasks)) / 9.0f : 0.0f;
+        out[11] = texture.straightPossible ? 1.0f : 0.0f;
+        out[12] = withHand.connectedness == 4 && rank < STRAIGHT ? 1.0f : 0.0f;
+        out[13] = ((high > boardTop ? 1 : 0) + (low > boardTop ? 1 : 0)) / 2.0f;
+        out[14] = static_cast<float>(std::max(0.0, std::min(1.0, potOdds)));
+        out[15] = static_cast<float>(opponents) / MAX_OPPONENTS;
+        out[16] = boardSize > 0 ? texture.nutClass / 9.0f : 0.0f;
+    }
+};
+
+// MCTS node for poker decisions. Tree nodes live in an index-addressed arena, so the
+// links are positions in that arena (-1 for none) rather than pointers.
+class MCTSNode {
+private:
+    double wins;          // total reward (1 per win for plain equity runs)
+    int visits;
+    double explorationParameter;
+    int firstChild;
+    int nextSibling;
+    int childCount;
+    int move;             // action or dealt cards leading to this node
+    
+public:
+    MCTSNode() : wins(0), visits(0), explorationParameter(UCB1_CONSTANT),
+                 firstChild(-1), nextSibling(-1), childCount(0), move(-1) {}
+    
+    explicit MCTSNode(int moveValue) : wins(0), visits(0), explorationParameter(UCB1_CONSTANT),
+                                       firstChild(-1), nextSibling(-1), childCount(0), move(moveValue) {}
+    
+    void update(bool isWin) {
+        update(isWin ? 1.0 : 0.0);
+    }
+    
+    void update(double reward) {
+        visits++;
+        wins += reward;
+    }
+    
+    // Start from existing statistics (opening book priors)
+    void setStatistics(double totalReward, int visitCount) {
+        wins = totalReward;
+        visits = visitCount;
+    }
+    
+    double getWinProbability() const {
+        if (visits == 0) return 0.0;
+        return wins / visits;
+    }
+    
+    int getVisits() const {
+        return visits;
+    }
+    
+    double getWins() const {
+        return wins;
+    }
+    
+    double getUCB1Value(int parentVisits) const {
+        if (visits == 0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        
+        double exploitation = wins / visits;
+        double exploration = explorationParameter * std::sqrt(std::log(parentVisits) / visits);
+        
+        return exploitation + exploration;
+    }
+    
+    int getFirstChild() const {
+        return firstChild;
+    }
+    
+    // Make `child` the head of the child list (the caller links the old head as its sibling)
+    void linkChild(int child) {
+        firstChild = child;
+        childCount++;
+    }
+    
+    // Detach a child; `newFirstChild` is the list head afterwards (the caller relinks siblings)
+    void unlinkChild(int newFirstChild) {
+        firstChild = newFirstChild;
+        childCount--;
+    }
+    
+    int getChildCount() const {
+        return childCount;
+    }
+    
+    int getNextSibling() const {
+        return nextSibling;
+    }
+    
+    void setNextSibling(int sibling) {
+        nextSibling = sibling;
+    }
+    
+    int getMove() const {
+        return move;
+    }
+};
+
+// Bot actions in the search tree
+enum SearchAction {
+    ACTION_FOLD = 0,
+    ACTION_STAY
+};
+
+// One node of a serialized search tree. Links are indices relative to the spot's first
+// node and moves use canonical suits, so a tree can be read in place at any address.
+struct BookNode {
+    float wins;
+    unsigned int visits;
+    int firstChild;
+    int nextSibling;
+    int move;
+};
+
+// Settings that change what a search's statistics mean. A book records the ones its trees
+// were searched under, and only searches under the same settings are seeded from it.
+struct BookModel {
+    double potOdds;                       // rollout policy's price to call, -1 without a policy
+    unsigned long long leafFingerprint;   // LeafEvaluator::fingerprint(), 0 when leaves are rolled out
+
+    bool operator==(const BookModel& other) const {
+        return potOdds == other.potOdds && leafFingerprint == other.leafFingerprint;
+    }
+};
+
+// Information-set MCTS over the bot's stay/fold choice on each remaining street.
+// Decision nodes have a FOLD child (worth WIN_PROBABILITY_THRESHOLD, the same bar
+// shouldStay applies) and a STAY child. A STAY child on an incomplete board is a chance
+// node whose children are keyed by the next street's cards; those are public, so each
+// child is one of the bot's information sets. The opponent's hole cards stay hidden:
+// every iteration samples one determinization (runout order and opponent hands), and
+// statistics from all determinizations accumulate in the same information-set nodes.
+// Rewards are the bot's pot share at showdown.
+class InfoSetSearch {
+private:
+    std::vector<MCTSNode> nodes;
+    std::unordered_map<long long, int> chanceChildren;   // (chance node, dealt cards) -> child
+    std::unordered_map<int, std::vector<int> > chanceLists;   // chance node -> its children
+    int hero[2];
+    std::vector<int> knownBoard;
+    std::vector<int> live;        // unseen cards, reshuffled per iteration
+    std::vector<int> path;
+    std::vector<int> freeSlots;   // arena slots of pruned nodes, reused before growing
+    long long prunedNodes;
+    size_t bookNodes;             // nodes seeded from an opening book
+    int opponents;
+    size_t maxNodes;
+    const RolloutPolicy* policy;  // NULL: opponents always continue to showdown
+    double potOdds;
+    int oddsBucket;
+    const LeafEvaluator* leaf;    // NULL: every leaf is rolled out
+    long long iterations;
+    double stayRewardSum;         // rewards of this search's iterations through the root's STAY
+    double stayRewardSquares;
+    long long stayRewardCount;
+    mutable double cachedStayValue;
+    mutable long long cachedStayIteration;    // iterations when cachedStayValue was computed (-1: none)
+
+    int addChild(int parent, int move) {
+        int index;
+        if (!freeSlots.empty()) {
+            index = freeSlots.back();
+            freeSlots.pop_back();
+            nodes[index] = MCTSNode(move);
+        } else {
+            index = static_cast<int>(nodes.size());
+            nodes.push_back(MCTSNode(move));
+        }
+        nodes[index].setNextSibling(nodes[parent].getFirstChild());
+        nodes[parent].linkChild(index);
+        return index;
+    }
+
+    size_t liveNodeCount() const {
+        return nodes.size() - freeSlots.size();
+    }
+
+    // Relabel the suits of a chance move (one card, or a sorted flop) through suitMap
+    static int remapMove(int move, int cards, const int suitMap[4]) {
+        if (cards == 1) {
+            return suitMap[move / 13] * 13 + move % 13;
+        }
+        int flop[3] = {move / (DECK_SIZE * DECK_SIZE), move / DECK_SIZE % DECK_SIZE, move % DECK_SIZE};
+        for (int i = 0; i < 3; i++) {
+            flop[i] = suitMap[flop[i] / 13] * 13 + flop[i] % 13;
+        }
+        std::sort(flop, flop + 3);
+        return (flop[0] * DECK_SIZE + flop[1]) * DECK_SIZE + flop[2];
+    }
+
+    static long long chanceKey(int node, int move) {
+        return (static_cast<long long>(node) << 18) | move;
+    }
+
+    // Deal `count` cards from live[dealt..] into the board and return their move encoding
+    int dealStreet(int count, int& dealt, int* board, int& boardSize) {
+        int liveCount = static_cast<int>(live.size());
+        int cards[3];
+        for (int i = 0; i < count; i++) {
+            int j = dealt + std::rand() % (liveCount - dealt);
+            std::swap(live[dealt], live[j]);
+            cards[i] = live[dealt++];
+            board[boardSize++] = cards[i];
+        }
+        if (count == 1) return cards[0];
+        std::sort(cards, cards + 3);
+        return (cards[0] * DECK_SIZE + cards[1]) * DECK_SIZE + cards[2];
+    }
+
+    // Deal the cards encoded by an existing chance child, keeping the determinization consistent
+    void dealMove(int move, int count, int& dealt, int* board, int& boardSize) {
+        int cards[3] = {move, -1, -1};
+        if (count == 3) {
+            cards[0] = move / (DECK_SIZE * DECK_SIZE);
+            cards[1] = move / DECK_SIZE % DECK_SIZE;
+            cards[2] = move % DECK_SIZE;
+        }
+        for (int i = 0; i < count; i++) {
+            int j = static_cast<int>(std::find(live.begin() + dealt, live.end(), cards[i]) - live.begin());
+            std::swap(live[dealt], live[j]);
+            board[boardSize++] = live[dealt++];
+        }
+    }
+
+    // Progressive widening: once a chance node holds ceil(C * n^alpha) children, revisit one of
+    // them instead of sampling a new street. Every street is equally likely, so a uniform pick
+    // among the existing children keeps the runout distribution unbiased. Returns -1 when the
+    // node may still widen.
+    int widenedChild(int chance) const {
+        double limit = std::ceil(WIDENING_COEFFICIENT *
+                                 std::pow(static_cast<double>(nodes[chance].getVisits() + 1), WIDENING_EXPONENT));
+        if (nodes[chance].getChildCount() < limit) return -1;
+        const std::vector<int>& children = chanceLists.find(chance)->second;
+        return children[std::rand() % children.size()];
+    }
+
+    // Deal every opponent's hole cards from live[dealt..]
+    void dealHoles(int& dealt, int holes[MAX_OPPONENTS][2]) {
+        int liveCount = static_cast<int>(live.size());
+        for (int o = 0; o < opponents; o++) {
+            for (int c = 0; c < 2; c++) {
+                int j = dealt + std::rand() % (liveCount - dealt);
+                std::swap(live[dealt], live[j]);
+                holes[o][c] = live[dealt++];
+            }
+        }
+    }
+
+    // Every opponent still in the hand acts once from the rollout policy on the street with the
+    // first `boardSize` cards of `board`. Returns true when all of them have folded.
+    bool opponentsFold(const int holes[MAX_OPPONENTS][2], bool* folded, const int* board, int boardSize) const {
+        int boardMasks[4] = {0, 0, 0, 0};
+        for (int i = 0; i < boardSize; i++) {
+            boardMasks[board[i] / 13] |= 1 << (board[i] % 13);
+        }
+        Street street = boardSize == 0 ? STREET_PREFLOP : static_cast<Street>(boardSize - 2);
+        int inHand = 0;
+        for (int o = 0; o < opponents; o++) {
+            if (folded[o]) continue;
+            int bucket = RolloutPolicy::strengthBucket(holes[o], boardMasks, boardSize);
+            folded[o] = policy->sample(bucket, street, oddsBucket) == OPPONENT_FOLD;
+            if (!folded[o]) inHand++;
+        }
+        return inHand == 0;
+    }
+
+    // With a rollout policy, the opponents act on the `count` streets (board sizes) the bot
+    // stayed through on the tree path, so iterations that end in the tree (a fold or a leaf
+    // model) see the same opponents as rollouts do. True when all of them folded there.
+    bool foldedInTree(int dealt, const int* board, const int* streets, int count) {
+        if (policy == NULL || count == 0) return false;
+        int holes[MAX_OPPONENTS][2];
+        bool folded[MAX_OPPONENTS] = {false};
+        dealHoles(dealt, holes);
+        for (int i = 0; i < count; i++) {
+            if (opponentsFold(holes, folded, board, streets[i])) return true;
+        }
+        return false;
+    }
+
+    // Deal the opponents, finish the board and score the bot's pot share. With a rollout
+    // policy every live opponent acts once per street: first on the `treeCount` streets the
+    // bot already stayed through in the tree (`treeStreets`, board sizes before `boardSize`),
+    // then on every street from here on. If all of them fold the bot takes the pot without a
+    // showdown.
+    double rollout(int dealt, int* board, int boardSize, const int* treeStreets, int treeCount,
+                   HandRank& heroRank, HandRank& opponentRank, bool& reachedShowdown) {
+        int holes[MAX_OPPONENTS][2];
+        dealHoles(dealt, holes);
+        
+        bool folded[MAX_OPPONENTS] = {false};
+        if (policy != NULL) {
+            for (int i = 0; i < treeCount; i++) {
+                if (opponentsFold(holes, folded, board, treeStreets[i])) {
+                    reachedShowdown = false;
+                    return 1.0;
+                }
+            }
+        }
+        while (true) {
+            if (policy != NULL && opponentsFold(holes, folded, board, boardSize)) {
+                reachedShowdown = false;
+                return 1.0;
+            }
+            if (boardSize == 5) break;
+            dealStreet(boardSize == 0 ? 3 : 1, dealt, board, boardSize);
+        }
+        int boardMasks[4] = {0, 0, 0, 0};
+        for (int i = 0; i < boardSize; i++) {
+            boardMasks[board[i] / 13] |= 1 << (board[i] % 13);
+        }
+        
+        int hand[4];
+        std::copy(boardMasks, boardMasks + 4, hand);
+        hand[hero[0] / 13] |= 1 << (hero[0] % 13);
+        hand[hero[1] / 13] |= 1 << (hero[1] % 13);
+        int heroStrength = HandEvaluator::evaluateMasks(hand);
+        
+        int best = 0;
+        int tied = 0;
+        for (int o = 0; o < opponents; o++) {
+            if (folded[o]) continue;
+            std::copy(boardMasks, boardMasks + 4, hand);
+            hand[holes[o][0] / 13] |= 1 << (holes[o][0] % 13);
+            hand[holes[o][1] / 13] |= 1 << (holes[o][1] % 13);
+            int strength = HandEvaluator::evaluateMasks(hand);
+            best = std::max(best, strength);
+            if (strength == heroStrength) tied++;
+        }
+        heroRank = HandEvaluator::packedRank(heroStrength);
+        opponentRank = HandEvaluator::packedRank(best);
+        reachedShowdown = true;
+        if (best > heroStrength) return 0.0;
+        return 1.0 / (tied + 1);
+    }
+
+    // Free whole subtrees under chance nodes, least visited first, until the tree is back to
+    // (1 - ISMCTS_PRUNE_FRACTION) of its budget. Freed slots go on the free list and their
+    // lookup entries are erased, so search continues in bounded memory. Runs between
+    // iterations only, so no path holds a freed index.
+    void prune() {
+        std::vector<std::pair<int, std::pair<int, int> > > candidates;   // visits, (chance node, child)
+        for (std::unordered_map<int, std::vector<int> >::const_iterator it = chanceLists.begin();
+             it != chanceLists.end(); ++it) {
+            for (size_t i = 0; i < it->second.size(); ++i) {
+                int child = it->second[i];
+                candidates.push_back(std::make_pair(nodes[child].getVisits(), std::make_pair(it->first, child)));
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+        
+        size_t target = static_cast<size_t>(maxNodes * (1.0 - ISMCTS_PRUNE_FRACTION));
+        std::vector<char> freed(nodes.size(), 0);
+        std::vector<int> stack;
+        for (size_t c = 0; c < candidates.size() && liveNodeCount() > target; ++c) {
+            int parent = candidates[c].second.first;
+            int child = candidates[c].second.second;
+            if (freed[child] || freed[parent]) continue;
+            
+            // Unlink from the chance node's sibling list and child list
+            int next = nodes[child].getNextSibling();
+            if (nodes[parent].getFirstChild() == child) {
+                nodes[parent].unlinkChild(next);
+            } else {
+                int previous = nodes[parent].getFirstChild();
+                while (nodes[previous].getNextSibling() != child) {
+                    previous = nodes[previous].getNextSibling();
+                }
+                nodes[previous].setNextSibling(next);
+                nodes[parent].unlinkChild(nodes[parent].getFirstChild());
+            }
+            std::vector<int>& siblings = chanceLists[parent];
+            siblings.erase(std::find(siblings.begin(), siblings.end(), child));
+            chanceChildren.erase(chanceKey(parent, nodes[child].getMove()));
+            
+            // Free the subtree, dropping the lookup entries of every chance node inside it
+            stack.push_back(child);
+            while (!stack.empty()) {
+                int node = stack.back();
+                stack.pop_back();
+                freed[node] = 1;
+                freeSlots.push_back(node);
+                prunedNodes++;
+                std::unordered_map<int, std::vector<int> >::iterator list = chanceLists.find(node);
+                if (list != chanceLists.end()) {
+                    for (size_t i = 0; i < list->second.size(); ++i) {
+                        chanceChildren.erase(chanceKey(node, nodes[list->second[i]].getMove()));
+                    }
+                    chanceLists.erase(list);
+                }
+                for (int grandchild = nodes[node].getFirstChild(); grandchild >= 0;
+                     grandchild = nodes[grandchild].getNextSibling()) {
+                    stack.push_back(grandchild);
+                }
+            }
+        }
+    }
+
+    // Book statistics scaled by `scale`, keeping at least one visit and the node's mean
+    void seedStatistics(int node, const BookNode& entry, double scale) {
+        if (entry.visits == 0) {
+            nodes[node].setStatistics(0.0, 0);
+            return;
+        }
+        int visits = std::max(1, static_cast<int>(entry.visits * scale + 0.5));
+        nodes[node].setStatistics(static_cast<double>(entry.wins) / entry.visits * visits, visits);
+    }
+
+    // Value of a subtree when the bot plays its most-tried action at every later decision.
+    // A decision node is worth its most-visited action (its own rollout mean before either
+    // action has been tried); a chance node is worth the visit-weighted value of its children
+    // plus the mean of its iterations that no child holds (budget-limited or pruned).
+    // Backed-up means would instead mix in every exploratory FOLD at young decision nodes.
+    double nodeValue(int node, bool decision) const {
+        if (decision) {
+            int best = -1;
+            for (int child = nodes[node].getFirstChild(); child >= 0; child = nodes[child].getNextSibling()) {
+                if (nodes[child].getVisits() == 0) continue;
+                if (best < 0 || nodes[child].getVisits() > nodes[best].getVisits() ||
+                    (nodes[child].getVisits() == nodes[best].getVisits() && nodes[child].getMove() == ACTION_STAY)) {
+                    best = child;
+                }
+            }
+            if (best < 0) return nodes[node].getWinProbability();
+            return nodes[best].getMove() == ACTION_FOLD ? nodes[best].getWinProbability() : nodeValue(best, false);
+        }
+        double total = 0.0;
+        double childRewards = 0.0;
+        int childVisits = 0;
+        for (int child = nodes[node].getFirstChild(); child >= 0; child = nodes[child].getNextSibling()) {
+            int visits = nodes[child].getVisits();
+            if (visits == 0) continue;
+            total += visits * nodeValue(child, true);
+            childRewards += nodes[child].getWins();
+            childVisits += visits;
+        }
+        int rest = nodes[node].getVisits() - childVisits;
+        if (rest > 0) {
+            total += nodes[node].getWins() - childRewards;
+        }
+        int visits = childVisits + std::max(rest, 0);
+        return visits > 0 ? total / visits : 0.0;
+    }
+
+    int selectChild(int node) const {
+        int parentVisits = nodes[node].getVisits();
+        int best = -1;
+        double bestValue = -1.0;
+        for (int child = nodes[node].getFirstChild(); child >= 0; child = nodes[child].getNextSibling()) {
+            double value = nodes[child].getUCB1Value(parentVisits);
+            if (value > bestValue) {
+                bestValue = value;
+                best = child;
+            }
+        }
+        return best;
+    }
+
+public:
+    InfoSetSearch() : prunedNodes(0), bookNodes(0), opponents(1), maxNodes(ISMCTS_MAX_NODES), policy(NULL), potOdds(DEFAULT_POT_ODDS),
+                      oddsBucket(RolloutPolicy::potOddsBucket(DEFAULT_POT_ODDS)), leaf(NULL), iterations(0),
+                      stayRewardSum(0.0), stayRewardSquares(0.0), stayRewardCount(0), cachedStayValue(0.0),
+                      cachedStayIteration(-1) {
+        hero[0] = hero[1] = -1;
+    }
+
+    // Opponent policy for rollouts and the price to call opponents face (NULL policy disables)
+    void setRolloutPolicy(const RolloutPolicy* rolloutPolicy, double price) {
+        policy = rolloutPolicy;
+        potOdds = price;
+        oddsBucket = RolloutPolicy::potOddsBucket(price);
+    }
+
+    // Value new leaves on an incomplete board with this model instead of a rollout (NULL disables)
+    void setLeafEvaluator(const LeafEvaluator* evaluator) {
+        leaf = evaluator;
+    }
+
+    // Most tree nodes kept at once; reaching it prunes the least-visited subtrees
+    void setNodeBudget(size_t budget) {
+        maxNodes = std::max(budget, static_cast<size_t>(16));
+    }
+
+    // Rollout policy and leaf model this search runs under, as an opening book records them
+    BookModel model() const {
+        BookModel current = {policy != NULL ? potOdds : -1.0, leaf != NULL ? leaf->fingerprint() : 0};
+        return current;
+    }
+
+    // Start a fresh tree for the bot's current information set
+    void reset(const std::vector<Card>& holeCards, const std::vector<Card>& community, int opponentCount) {
+        hero[0] = holeCards[0].toInt();
+        hero[1] = holeCards[1].toInt();
+        knownBoard.clear();
+        for (size_t i = 0; i < community.size(); ++i) {
+            knownBoard.push_back(community[i].toInt());
+        }
+        live.clear();
+        for (int card = 0; card < DECK_SIZE; card++) {
+            if (card != hero[0] && card != hero[1] &&
+                std::find(knownBoard.begin(), knownBoard.end(), card) == knownBoard.end()) {
+                live.push_back(card);
+            }
+        }
+        opponents = opponentCount;
+        nodes.clear();
+        chanceChildren.clear();
+        chanceLists.clear();
+        freeSlots.clear();
+        prunedNodes = 0;
+        bookNodes = 0;
+        iterations = 0;
+        stayRewardSum = stayRewardSquares = 0.0;
+        stayRewardCount = 0;
+        cachedStayIteration = -1;
+        nodes.push_back(MCTSNode());
+    }
+
+    // One determinized iteration: select down the tree, expand at most one information
+    // set, roll out by staying to showdown, and back the reward up the path. `showdown`
+    // is false when the iteration ended in a fold.
+    double iterate(HandRank& heroRank, HandRank& opponentRank, bool& reachedShowdown) {
+        int board[5];
+        int boardSize = static_cast<int>(knownBoard.size());
+        std::copy(knownBoard.begin(), knownBoard.end(), board);
+        int dealt = 0;
+        double reward = 0.0;
+        int stayed[4];              // board sizes of the streets the bot stayed through
+        int stayedCount = 0;
+        reachedShowdown = false;
+        
+        if (liveNodeCount() + ISMCTS_ITERATION_NODES > maxNodes) {
+            prune();
+        }
+        path.clear();
+        int node = 0;
+        path.push_back(node);
+        while (true) {
+            // Decision node: both actions are created on the first visit. If pruning left no
+            // room for them, the node stays a leaf and is rolled out as a stay.
+            if (nodes[node].getFirstChild() < 0) {
+                if (liveNodeCount() + 2 > maxNodes) {
+                    reward = rollout(dealt, board, boardSize, stayed, stayedCount, heroRank, opponentRank,
+                                     reachedShowdown);
+                    break;
+                }
+                addChild(node, ACTION_FOLD);
+                addChild(node, ACTION_STAY);
+            }
+            int action = selectChild(node);
+            path.push_back(action);
+            if (nodes[action].getMove() == ACTION_FOLD) {
+                reward = foldedInTree(dealt, board, stayed, stayedCount) ? 1.0 : WIN_PROBABILITY_THRESHOLD;
+                break;
+            }
+            if (boardSize == 5) {
+                reward = rollout(dealt, board, boardSize, stayed, stayedCount, heroRank, opponentRank, reachedShowdown);
+                break;
+            }
+            stayed[stayedCount++] = boardSize;
+            
+            // Chance node: a widened node revisits an existing child, otherwise the sampled
+            // street selects (or creates) the next information set
+            int streetCards = boardSize == 0 ? 3 : 1;
+            int revisit = widenedChild(action);
+            if (revisit >= 0) {
+                dealMove(nodes[revisit].getMove(), streetCards, dealt, board, boardSize);
+                node = revisit;
+                path.push_back(node);
+                continue;
+            }
+            int move = dealStreet(streetCards, dealt, board, boardSize);
+            std::unordered_map<long long, int>::iterator found = chanceChildren.find(chanceKey(action, move));
+            if (found == chanceChildren.end()) {
+                if (liveNodeCount() < maxNodes) {
+                    int child = addChild(action, move);
+                    chanceChildren[chanceKey(action, move)] = child;
+                    chanceLists[action].push_back(child);
+                    path.push_back(child);
+                }
+                if (leaf != NULL && boardSize < 5) {
+                    if (foldedInTree(dealt, board, stayed, stayedCount)) {
+                        reward = 1.0;
+                    } else {
+                        float features[LEAF_FEATURES];
+                        LeafEvaluator::features(hero, board, boardSize, opponents, potOdds, features);
+                        reward = leaf->evaluate(features);
+                    }
+                } else {
+                    reward = rollout(dealt, board, boardSize, stayed, stayedCount, heroRank, opponentRank,
+                                     reachedShowdown);
+                }
+                break;
+            }
+            node = found->second;
+            path.push_back(node);
+        }
+        
+        for (size_t i = 0; i < path.size(); ++i) {
+            nodes[path[i]].update(reward);
+        }
+        if (nodes[path[1]].getMove() == ACTION_STAY) {
+            stayRewardSum += reward;
+            stayRewardSquares += reward * reward;
+            stayRewardCount++;
+        }
+        iterations++;
+        return reward;
+    }
+
+    // Value of staying at the root information set, with the bot's most-tried action at
+    // every later decision (see nodeValue). Cached until the next iteration.
+    double stayValue() const {
+        if (cachedStayIteration == iterations) return cachedStayValue;
+        cachedStayValue = 0.0;
+        for (int child = nodes[0].getFirstChild(); child >= 0; child = nodes[child].getNextSibling()) {
+            if (nodes[child].getMove() == ACTION_STAY) cachedStayValue = nodeValue(child, false);
+        }
+        cachedStayIteration = iterations;
+        return cachedStayValue;
+    }
+
+    // 95% normal interval around stayValue, with the standard error of this search's rewards
+    // through the root's STAY action (their sum and sum of squares)
+    void stayInterval(double& low, double& high) const {
+        if (stayRewardCount < 2) {
+            low = 0.0;
+            high = 1.0;
+            return;
+        }
+        double n = static_cast<double>(stayRewardCount);
+        double mean = stayRewardSum / n;
+        double variance = std::max(0.0, (stayRewardSquares - n * mean * mean) / (n - 1));
+        double margin = 1.96 * std::sqrt(variance / n);
+        double center = stayValue();
+        low = std::max(0.0, center - margin);
+        high = std::min(1.0, center + margin);
+    }
+
+    size_t nodeCount() const {
+        return liveNodeCount();
+    }
+
+    long long getPrunedNodes() const {
+        return prunedNodes;
+    }
+
+    size_t getBookNodes() const {
+        return bookNodes;
+    }
+
+    // Append the tree to `out` in breadth-first order with relative links, relabeling chance
+    // moves through suitMap (actual suit -> canonical suit). Information sets with fewer than
+    // minVisits visits are left out along with their subtrees.
+    void exportTree(const int suitMap[4], int minVisits, std::vector<BookNode>& out) const {
+        struct Pending {
+            int node;
+            int boardSize;
+            bool decision;
+        };
+        size_t base = out.size();
+        std::vector<Pending> queue;
+        Pending root = {0, static_cast<int>(knownBoard.size()), true};
+        queue.push_back(root);
+        BookNode rootNode = {static_cast<float>(nodes[0].getWins()), static_cast<unsigned int>(nodes[0].getVisits()),
+                             -1, -1, -1};
+        out.push_back(rootNode);
+        for (size_t q = 0; q < queue.size(); ++q) {
+            Pending item = queue[q];
+            int streetCards = item.boardSize == 0 ? 3 : 1;
+            int previous = -1;
+            for (int child = nodes[item.node].getFirstChild(); child >= 0; child = nodes[child].getNextSibling()) {
+                if (!item.decision && nodes[child].getVisits() < minVisits) continue;
+                int move = item.decision ? nodes[child].getMove() : remapMove(nodes[child].getMove(), streetCards, suitMap);
+                int index = static_cast<int>(out.size() - base);
+                BookNode node = {static_cast<float>(nodes[child].getWins()),
+                                 static_cast<unsigned int>(nodes[child].getVisits()), -1, -1, move};
+                out.push_back(node);
+                if (previous < 0) {
+                    out[base + q].firstChild = index;
+                } else {
+                    out[base + previous].nextSibling = index;
+                }
+                previous = index;
+                Pending next = {child, item.decision ? item.boardSize : item.boardSize + streetCards, !item.decision};
+                queue.push_back(next);
+            }
+        }
+    }
+
+    // Rebuild a book tree (from exportTree) under the root of a freshly reset search, with its
+    // statistics as priors. suitMap relabels canonical suits to this spot's suits. Links must
+    // point forward inside the block; seeding stops at the node budget.
+    void seedFromBook(const BookNode* book, size_t count, const int suitMap[4]) {
+        struct Pending {
+            int bookIndex;
+            int node;
+            int boardSize;
+            bool decision;
+        };
+        if (count == 0) return;
+        cachedStayIteration = -1;
+        // A long book search would swamp the live one, so the prior is scaled down to at most
+        // BOOK_PRIOR_VISITS root visits; every node keeps its mean
+        double scale = std::min(1.0, static_cast<double>(BOOK_PRIOR_VISITS) / std::max(1u, book[0].visits));
+        seedStatistics(0, book[0], scale);
+        std::vector<Pending> queue;
+        Pending root = {0, 0, static_cast<int>(knownBoard.size()), true};
+        queue.push_back(root);
+        for (size_t q = 0; q < queue.size(); ++q) {
+            Pending item = queue[q];
+            int streetCards = item.boardSize == 0 ? 3 : 1;
+            int previous = item.bookIndex;
+            for (int b = book[item.bookIndex].firstChild; b > previous && static_cast<size_t>(b) < count;
+                 b = book[b].nextSibling) {
+                if (liveNodeCount() >= maxNodes) return;
+                int move = item.decision ? book[b].move : remapMove(book[b].move, streetCards, suitMap);
+                int child = addChild(item.node, move);
+                seedStatistics(child, book[b], scale);
+                if (!item.decision) {
+                    chanceChildren[chanceKey(item.node, move)] = child;
+                    chanceLists[item.node].push_back(child);
+                }
+                bookNodes++;
+                Pending next = {b, child, item.decision ? item.boardSize : item.boardSize + streetCards, !item.decision};
+                queue.push_back(next);
+                previous = b;
+            }
+        }
+    }
+
+    // Mean rollout reward from the current information set with no tree (self-play targets)
+    double rolloutValue(int samples) {
+        double total = 0.0;
+        int board[5];
+        HandRank heroRank;
+        HandRank opponentRank;
+        bool reachedShowdown;
+        for (int n = 0; n < samples; n++) {
+            std::copy(knownBoard.begin(), knownBoard.end(), board);
+            total += rollout(0, board, static_cast<int>(knownBoard.size()), NULL, 0, heroRank, opponentRank,
+                             reachedShowdown);
+        }
+        return total / samples;
+    }
+};
+
+// Self-play training data for LeafEvaluator: random hands on random preflop, flop and turn
+// boards, one CSV line per situation with the features followed by the mean rollout reward.
+// With a rollout policy the price to call is drawn per situation.
+bool dumpLeafSamples(const std::string& path, int count, const RolloutPolicy* policy) {
+    std::ofstream out(path.c_str());
+    if (!out) {
+        return false;
+    }
+    static const int BOARD_SIZES[3] = {0, 3, 4};
+    InfoSetSearch search;
+    for (int n = 0; n < count; n++) {
+        Deck deck;
+        deck.shuffle();
+        std::vector<Card> hole;
+        hole.push_back(deck.deal());
+        hole.push_back(deck.deal());
+        std::vector<Card> board;
+        int boardSize = BOARD_SIZES[std::rand() % 3];
+        for (int i = 0; i < boardSize; i++) {
+            board.push_back(deck.deal());
+        }
+        int opponents = 1 + std::rand() % 4;
+        double potOdds = policy != NULL ? 0.5 * std::rand() / RAND_MAX : DEFAULT_POT_ODDS;
+        
+        search.setRolloutPolicy(policy, potOdds);
+        search.reset(hole, board, opponents);
+        int hero[2] = {hole[0].toInt(), hole[1].toInt()};
+        int boardCards[5] = {0, 0, 0, 0, 0};
+        for (int i = 0; i < boardSize; i++) {
+            boardCards[i] = board[i].toInt();
+        }
+        float features[LEAF_FEATURES];
+        LeafEvaluator::features(hero, boardCards, boardSize, opponents, potOdds, features);
+        for (int i = 0; i < LEAF_FEATURES; i++) {
+            out << features[i] << ",";
+        }
+        out << search.rolloutValue(LEAF_ROLLOUTS_PER_SAMPLE) << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+// Fit LeafEvaluator in float on dumped samples (cross-entropy against the soft targets, SGD
+// with momentum), then quantize and save. The last tenth of the samples is held out and
+// reported for both the float and the quantized model.
+bool trainLeafEvaluator(const std::string& samplesPath, const std::string& modelPath) {
+    std::ifstream in(samplesPath.c_str());
+    std::vector<float> inputs;
+    std::vector<float> targets;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string field;
+        std::vector<float> values;
+        while (std::getline(fields, field, ',')) {
+            values.push_back(static_cast<float>(std::atof(field.c_str())));
+        }
+        if (values.size() != static_cast<size_t>(LEAF_FEATURES + 1)) continue;
+        inputs.insert(inputs.end(), values.begin(), values.begin() + LEAF_FEATURES);
+        targets.push_back(values[LEAF_FEATURES]);
+    }
+    int total = static_cast<int>(targets.size());
+    int training = total - total / 10;
+    if (training < 1) {
+        return false;
+    }
+    
+    std::vector<float> hidden(LEAF_HIDDEN * LEAF_FEATURES);
+    std::vector<float> hiddenBias(LEAF_HIDDEN, 0.0f);
+    std::vector<float> output(LEAF_HIDDEN);
+    float outputBias = 0.0f;
+    float range = std::sqrt(6.0f / (LEAF_FEATURES + LEAF_HIDDEN));
+    for (size_t i = 0; i < hidden.size(); ++i) {
+        hidden[i] = range * (2.0f * std::rand() / RAND_MAX - 1.0f);
+    }
+    for (int j = 0; j < LEAF_HIDDEN; j++) {
+        output[j] = range * (2.0f * std::rand() / RAND_MAX - 1.0f);
+    }
+    std::vector<float> hiddenVelocity(hidden.size(), 0.0f);
+    std::vector<float> hiddenBiasVelocity(LEAF_HIDDEN, 0.0f);
+    std::vector<float> outputVelocity(LEAF_HIDDEN, 0.0f);
+    float outputBiasVelocity = 0.0f;
+    const float momentum = 0.9f;
+    
+    std::vector<int> order(training);
+    for (int i = 0; i < training; i++) {
+        order[i] = i;
+    }
+    float activations[LEAF_HIDDEN];
+    for (int epoch = 0; epoch < LEAF_TRAINING_EPOCHS; epoch++) {
+        float rate = 0.01f / (1.0f + 0.1f * epoch);
+        for (int i = training - 1; i > 0; i--) {
+            std::swap(order[i], order[std::rand() % (i + 1)]);
+        }
+        for (int n = 0; n < training; n++) {
+            const float* x = &inputs[order[n] * LEAF_FEATURES];
+            float out = outputBias;
+            for (int j = 0; j < LEAF_HIDDEN; j++) {
+                float sum = hiddenBias[j];
+                for (int i = 0; i < LEAF_FEATURES; i++) {
+                    sum += hidden[j * LEAF_FEATURES + i] * x[i];
+                }
+                activations[j] = std::max(0.0f, sum);
+                out += output[j] * activations[j];
+            }
+            float error = 1.0f / (1.0f + std::exp(-out)) - targets[order[n]];
+            for (int j = 0; j < LEAF_HIDDEN; j++) {
+                if (activations[j] > 0.0f) {
+                    float delta = error * output[j];
+                    for (int i = 0; i < LEAF_FEATURES; i++) {
+                        float& velocity = hiddenVelocity[j * LEAF_FEATURES + i];
+                        velocity = momentum * velocity - rate * delta * x[i];
+                        hidden[j * LEAF_FEATURES + i] += velocity;
+                    }
+                    hiddenBiasVelocity[j] = momentum * hiddenBiasVelocity[j] - rate * delta;
+                    hiddenBias[j] += hiddenBiasVelocity[j];
+                }
+                outputVelocity[j] = momentum * outputVelocity[j] - rate * error * activations[j];
+                output[j] += outputVelocity[j];
+            }
+            outputBiasVelocity = momentum * outputBiasVelocity - rate * error;
+            outputBias += outputBiasVelocity;
+        }
+    }
+    
+    LeafEvaluator model;
+    model.setWeights(hidden, hiddenBias, output, outputBias);
+    double floatError = 0.0;
+    double quantizedError = 0.0;
+    for (int n = training; n < total; n++) {
+        const float* x = &inputs[n * LEAF_FEATURES];
+        float out = outputBias;
+        for (int j = 0; j < LEAF_HIDDEN; j++) {
+            float sum = hiddenBias[j];
+            for (int i = 0; i < LEAF_FEATURES; i++) {
+                sum += hidden[j * LEAF_FEATURES + i] * x[i];
+            }
+            out += output[j] * std::max(0.0f, sum);
+        }
+        double floatValue = 1.0 / (1.0 + std::exp(-out));
+        floatError += (floatValue - targets[n]) * (floatValue - targets[n]);
+        double quantizedValue = model.evaluate(x);
+        quantizedError += (quantizedValue - targets[n]) * (quantizedValue - targets[n]);
+    }
+    int held = std::max(1, total - training);
+    std::cout << "Trained on " << training << " samples; held-out RMSE " << std::fixed << std::setprecision(4)
+              << std::sqrt(floatError / held) << " (float), " << std::sqrt(quantizedError / held)
+              << " (int8)" << std::endl;
+    return model.save(modelPath);
+}
+
+// Index of the two-card combination {a, b} (card indices 0-51, a != b) in [0, COMBO_COUNT)
+int comboIndex(int a, int b) {
+    if (a > b) std::swap(a, b);
+    return b * (b - 1) / 2 + a;
+}
+
+// Packed strength of every two-card combo drawn from `cards` that avoids `deadMask`
+// (bit per card index) on a complete board, written to strengths[comboIndex]
+void fillComboStrengths(const int boardMasks[4], const std::vector<int>& cards, unsigned long long deadMask,
+                        int* strengths) {
+    int hand[4];
+    for (size_t i = 0; i < cards.size(); ++i) {
+        int a = cards[i];
+        if (deadMask & (1ULL << a)) continue;
+        for (size_t j = i + 1; j < cards.size(); ++j) {
+            int b = cards[j];
+            if (deadMask & (1ULL << b)) continue;
+            std::copy(boardMasks, boardMasks + 4, hand);
+            hand[a / 13] |= 1 << (a % 13);
+            hand[b / 13] |= 1 << (b % 13);
+            strengths[comboIndex(a, b)] = HandEvaluator::evaluateMasks(hand);
+        }
+    }
+}
+
+// Showdown strengths for every completion of a flop or turn board, built lazily.
+// Each runout gets one array holding the bot's strength and the strength of every
+// opponent combo, so a simulation resolves with two lookups instead of two evaluations.
+class BoardStrengthCache {
+private:
+    int botCards[2];
+    std::vector<int> boardCards;
+    std::vector<int> liveCards;                 // cards not held by the bot or on the board
+    int missing;                                // board cards still to come (0-2)
+    std::vector<std::vector<int> > tables;      // per runout: [0] bot, [1 + comboIndex] opponent
+    long long hits;
+    long long builds;
+
+    int runoutIndex(int first, int second) const {
+        return missing == 2 ? comboIndex(first, second) : (missing == 1 ? first : 0);
+    }
+
+    const std::vector<int>& table(int index, const int* runout) {
+        std::vector<int>& strengths = tables[index];
+        if (!strengths.empty()) {
+            hits++;
+            return strengths;
+        }
+        
+        TraceSpan span("board table build");
+        builds++;
+        strengths.assign(COMBO_COUNT + 1, 0);
+        int suitMasks[4] = {0, 0, 0, 0};
+        for (size_t i = 0; i < boardCards.size(); ++i) {
+            suitMasks[boardCards[i] / 13] |= 1 << (boardCards[i] % 13);
+        }
+        for (int i = 0; i < missing; i++) {
+            suitMasks[runout[i] / 13] |= 1 << (runout[i] % 13);
+        }
+        
+        int hand[4];
+        std::copy(suitMasks, suitMasks + 4, hand);
+        hand[botCards[0] / 13] |= 1 << (botCards[0] % 13);
+        hand[botCards[1] / 13] |= 1 << (botCards[1] % 13);
+        strengths[0] = HandEvaluator::evaluateMasks(hand);
+        
+        unsigned long long runoutMask = 0;
+        for (int i = 0; i < missing; i++) {
+            runoutMask |= 1ULL << runout[i];
+        }
+        fillComboStrengths(suitMasks, liveCards, runoutMask, &strengths[1]);
+        return strengths;
+    }
+
+public:
+    BoardStrengthCache() : missing(-1), hits(0), builds(0) {
+        botCards[0] = botCards[1] = -1;
+    }
+
+    // Only flop, turn and river boards have few enough runouts to tabulate
+    static bool applicable(const std::vector<Card>& holeCards, const std::vector<Card>& community) {
+        return holeCards.size() == 2 && community.size() >= 3 && community.size() <= 5;
+    }
+
+    // Point the cache at a situation; tables are kept when the cards are unchanged
+    void prepare(const std::vector<Card>& holeCards, const std::vector<Card>& community) {
+        std::vector<int> board;
+        for (size_t i = 0; i < community.size(); ++i) {
+            board.push_back(community[i].toInt());
+        }
+        if (holeCards[0].toInt() == botCards[0] && holeCards[1].toInt() == botCards[1] && board == boardCards) {
+            return;
+        }
+        
+        botCards[0] = holeCards[0].toInt();
+        botCards[1] = holeCards[1].toInt();
+        boardCards = board;
+        missing = 5 - static_cast<int>(board.size());
+        liveCards.clear();
+        for (int card = 0; card < DECK_SIZE; card++) {
+            if (card != botCards[0] && card != botCards[1] &&
+                std::find(boardCards.begin(), boardCards.end(), card) == boardCards.end()) {
+                liveCards.push_back(card);
+            }
+        }
+        tables.clear();
+        tables.resize(missing == 2 ? COMBO_COUNT : (missing == 1 ? DECK_SIZE : 1));
+    }
+
+    // Deal a random runout and opponent hand; true if the bot wins outright
+    bool simulate(HandRank& botRank, HandRank& opponentRank) {
+        int live = static_cast<int>(liveCards.size());
+        int picks[4];
+        int needed = missing + 2;
+        for (int i = 0; i < needed; i++) {
+            bool duplicate;
+            do {
+                picks[i] = std::rand() % live;
+                duplicate = false;
+                for (int k = 0; k < i; k++) {
+                    if (picks[k] == picks[i]) duplicate = true;
+                }
+            } while (duplicate);
+        }
+        
+        // Slots past `missing` stay zero; runoutIndex ignores them
+        int runout[2] = {0, 0};
+        for (int i = 0; i < missing; i++) {
+            runout[i] = liveCards[picks[i]];
+        }
+        const std::vector<int>& strengths = table(runoutIndex(runout[0], runout[1]), runout);
+        int opponent = comboIndex(liveCards[picks[missing]], liveCards[picks[missing + 1]]);
+        botRank = HandEvaluator::packedRank(strengths[0]);
+        opponentRank = HandEvaluator::packedRank(strengths[1 + opponent]);
+        return strengths[0] > strengths[1 + opponent];
+    }
+
+    long long getHits() const {
+        return hits;
+    }
+
+    long long getBuilds() const {
+        return builds;
+    }
+};
+
+// Starting-hand class on the usual 13x13 grid (row and column run A down to 2):
+// pairs on the diagonal, suited hands above it, offsuit hands below it
+int startingHandClass(int a, int b) {
+    int rowA = 12 - a % 13;
+    int rowB = 12 - b % 13;
+    int high = std::min(rowA, rowB);
+    int low = std::max(rowA, rowB);
+    bool suited = a / 13 == b / 13;
+    return suited ? high * 13 + low : low * 13 + high;
+}
+
+// Name of a starting-hand class, e.g. "AKs", "T9o", "77"
+std::string startingHandClassName(int handClass) {
+    static const char ranks[] = "AKQJT98765432";
+    int row = handClass / 13;
+    int col = handClass % 13;
+    std::string name;
+    name += ranks[std::min(row, col)];
+    name += ranks[std::max(row, col)];
+    if (row < col) name += "s";
+    else if (row > col) name += "o";
+    return name;
+}
+
+// Number of card combinations in a starting-hand class
+int startingHandClassCombos(int handClass) {
+    int row = handClass / 13;
+    int col = handClass % 13;
+    return row == col ? 6 : (row < col ? 4 : 12);
+}
+
+// Showdown outcomes from the first player's point of view
+struct ShowdownTally {
+    long long wins;
+    long long ties;
+    long long total;
+
+    ShowdownTally() : wins(0), ties(0), total(0) {}
+
+    void add(const ShowdownTally& other) {
+        wins += other.wins;
+        ties += other.ties;
+        total += other.total;
+    }
+
+    // Pot share with ties split
+    double equity() const {
+        return total > 0 ? (wins + 0.5 * ties) / total : 0.0;
+    }
+};
+
+// Walk every five-card board drawn from `live` whose first card is live[firstBegin..firstEnd).
+// The board masks are built one card per loop level and both hands are ORed in at the leaf.
+ShowdownTally enumerateHeadsUpBoards(const int hero[2], const int villain[2], const std::vector<int>& live,
+                                     int firstBegin, int firstEnd) {
+    ShowdownTally tally;
+    int heroMasks[4] = {0, 0, 0, 0};
+    int villainMasks[4] = {0, 0, 0, 0};
+    for (int i = 0; i < 2; i++) {
+        heroMasks[hero[i] / 13] |= 1 << (hero[i] % 13);
+        villainMasks[villain[i] / 13] |= 1 << (villain[i] % 13);
+    }
+    
+    int n = static_cast<int>(live.size());
+    int suitOf[DECK_SIZE];
+    int bitOf[DECK_SIZE];
+    for (int i = 0; i < n; i++) {
+        suitOf[i] = live[i] / 13;
+        bitOf[i] = 1 << (live[i] % 13);
+    }
+    
+    int m1[4], m2[4], m3[4], m4[4], leaf[4], hand[4];
+    for (int c1 = firstBegin; c1 < firstEnd; c1++) {
+        std::fill(m1, m1 + 4, 0);
+        m1[suitOf[c1]] |= bitOf[c1];
+        for (int c2 = c1 + 1; c2 < n; c2++) {
+            std::copy(m1, m1 + 4, m2);
+            m2[suitOf[c2]] |= bitOf[c2];
+            for (int c3 = c2 + 1; c3 < n; c3++) {
+                std::copy(m2, m2 + 4, m3);
+                m3[suitOf[c3]] |= bitOf[c3];
+                for (int c4 = c3 + 1; c4 < n; c4++) {
+                    std::copy(m3, m3 + 4, m4);
+                    m4[suitOf[c4]] |= bitOf[c4];
+                    for (int c5 = c4 + 1; c5 < n; c5++) {
+                        std::copy(m4, m4 + 4, leaf);
+                        leaf[suitOf[c5]] |= bitOf[c5];
+                        for (int s = 0; s < 4; s++) hand[s] = leaf[s] | heroMasks[s];
+                        int heroStrength = HandEvaluator::evaluateMasks(hand);
+                        for (int s = 0; s < 4; s++) hand[s] = leaf[s] | villainMasks[s];
+                        int villainStrength = HandEvaluator::evaluateMasks(hand);
+                        if (heroStrength > villainStrength) tally.wins++;
+                        else if (heroStrength == villainStrength) tally.ties++;
+                        tally.total++;
+                    }
+                }
+            }
+        }
+    }
+    return tally;
+}
+
+// Cards not held by either player, in ascending order
+std::vector<int> liveCardsExcluding(const int hero[2], const int villain[2]) {
+    std::vector<int> live;
+    for (int card = 0; card < DECK_SIZE; card++) {
+        if (card != hero[0] && card != hero[1] && card != villain[0] && card != villain[1]) {
+            live.push_back(card);
+        }
+    }
+    return live;
+}
+
+// Exact all-in equity of one hand against another over all C(48,5) boards, fast enough to
+// use live. Threads claim first-card positions from the front, where the most boards are.
+ShowdownTally exactHeadsUpEquity(const std::vector<Card>& heroCards, const std::vector<Card>& villainCards,
+                                 int threadCount = 0) {
+    int hero[2] = { heroCards[0].toInt(), heroCards[1].toInt() };
+    int villain[2] = { villainCards[0].toInt(), villainCards[1].toInt() };
+    std::vector<int> live = liveCardsExcluding(hero, villain);
+    if (live.size() != DECK_SIZE - 4) {
+        throw std::runtime_error("Hole cards must be four distinct cards");
+    }
+    
+    if (threadCount <= 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    int firstPositions = static_cast<int>(live.size()) - 4;
+    threadCount = std::min(threadCount, firstPositions);
+    
+    TraceSpan span("exact equity");
+    std::atomic<int> nextFirst(0);
+    std::vector<ShowdownTally> tallies(threadCount);
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threadCount; t++) {
+        workers.push_back(std::thread([&, t]() {
+            for (int first = nextFirst++; first < firstPositions; first = nextFirst++) {
+                tallies[t].add(enumerateHeadsUpBoards(hero, villain, live, first, first + 1));
+            }
+        }));
+    }
+    for (int first = nextFirst++; first < firstPositions; first = nextFirst++) {
+        tallies[0].add(enumerateHeadsUpBoards(hero, villain, live, first, first + 1));
+    }
+    for (size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+    
+    ShowdownTally total;
+    for (int t = 0; t < threadCount; t++) {
+        total.add(tallies[t]);
+    }
+    return total;
+}
+
+// Exact class-versus-class preflop all-in equity, stored as 16-bit fractions.
+// File layout: "PFEQ", uint32 version, then 169*169 uint16 (row = hero class).
+class PreflopEquityTable {
+private:
+    std::vector<unsigned short> equities;
+
+public:
+    static const unsigned int FILE_VERSION = 1;
+
+    PreflopEquityTable() : equities(STARTING_HAND_CLASSES * STARTING_HAND_CLASSES, 0) {}
+
+    bool load(const std::string& path) {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        char magic[4];
+        unsigned int version = 0;
+        in.read(magic, 4);
+        in.read(reinterpret_cast<char*>(&version), sizeof(version));
+        if (!in || std::string(magic, 4) != "PFEQ" || version != FILE_VERSION) {
+            return false;
+        }
+        in.read(reinterpret_cast<char*>(&equities[0]), equities.size() * sizeof(unsigned short));
+        return static_cast<bool>(in);
+    }
+
+    bool save(const std::string& path) const {
+        std::ofstream out(path.c_str(), std::ios::binary);
+        unsigned int version = FILE_VERSION;
+        out.write("PFEQ", 4);
+        out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        out.write(reinterpret_cast<const char*>(&equities[0]), equities.size() * sizeof(unsigned short));
+        return static_cast<bool>(out);
+    }
+
+    void set(int heroClass, int villainClass, double equity) {
+        equities[heroClass * STARTING_HAND_CLASSES + villainClass] =
+            static_cast<unsigned short>(equity * 65535.0 + 0.5);
+    }
+
+    double equity(int heroClass, int villainClass) const {
+        return equities[heroClass * STARTING_HAND_CLASSES + villainClass] / 65535.0;
+    }
+
+    // Range-versus-range equity as a combo-weighted table sum. Weights are per class
+    // (0-1); card removal between the two ranges is ignored.
+    double rangeEquity(const std::vector<double>& heroWeights, const std::vector<double>& villainWeights) const {
+        double weighted = 0.0;
+        double total = 0.0;
+        for (int h = 0; h < STARTING_HAND_CLASSES; h++) {
+            if (heroWeights[h] <= 0) continue;
+            double heroCombos = heroWeights[h] * startingHandClassCombos(h);
+            for (int v = 0; v < STARTING_HAND_CLASSES; v++) {
+                if (villainWeights[v] <= 0) continue;
+                double weight = heroCombos * villainWeights[v] * startingHandClassCombos(v);
+                weighted += weight * equity(h, v);
+                total += weight;
+            }
+        }
+        return total > 0 ? weighted / total : 0.0;
+    }
+};
+
+// Read-only view of a whole file, memory-mapped where the platform supports it so that
+// processes loading the same table share it through the page cache
+class MappedFile {
+private:
+    const char* bytes;
+    size_t length;
+    bool mapped;
+    std::vector<char> buffer;   // fallback copy when mmap is unavailable
+
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+public:
+    MappedFile() : bytes(NULL), length(0), mapped(false) {}
+
+    ~MappedFile() {
+        close();
+    }
+
+    bool open(const std::string& path) {
+        close();
+#ifdef POKERBOT_HAS_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* address = mmap(NULL, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (address == MAP_FAILED) return false;
+        bytes = static_cast<const char*>(address);
+        length = static_cast<size_t>(info.st_size);
+        mapped = true;
+        return true;
+#else
+        std::ifstream in(path.c_str(), std::ios::binary);
+        if (!in) return false;
+        buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        bytes = buffer.empty() ? NULL : &buffer[0];
+        length = buffer.size();
+        return length > 0;
+#endif
+    }
+
+    void close() {
+#ifdef POKERBOT_HAS_MMAP
+        if (mapped) munmap(const_cast<char*>(bytes), length);
+#endif
+        buffer.clear();
+        bytes = NULL;
+        length = 0;
+        mapped = false;
+    }
+
+    const char* data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+};
+
+#ifdef POKERBOT_HAS_IO_URING
+// Minimal io_uring over the raw system calls: a submission and a completion ring shared
+// with the kernel, buffers registered once so fixed reads and writes skip the per-call
+// page pinning, and completions reaped in batches.
+class IoUring {
+private:
+    int fd;
+    void* sqRing;
+    size_t sqRingSize;
+    void* cqRing;
+    size_t cqRingSize;
+    io_uring_sqe* sqes;
+    size_t sqesSize;
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned sqMask;
+    unsigned* sqArray;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    io_uring_cqe* cqes;
+    unsigned prepared;          // entries queued since the last submit
+
+    IoUring(const IoUring&);
+    IoUring& operator=(const IoUring&);
+
+public:
+    IoUring() : fd(-1), sqRing(MAP_FAILED), sqRingSize(0), cqRing(MAP_FAILED), cqRingSize(0),
+                sqes(NULL), sqesSize(0), sqHead(NULL), sqTail(NULL), sqMask(0), sqArray(NULL),
+                cqHead(NULL), cqTail(NULL), cqMask(0), cqes(NULL), prepared(0) {}
+
+    ~IoUring() {
+        close();
+    }
+
+    // False when the kernel (or a seccomp filter) does not allow io_uring
+    bool open(unsigned entries) {
+        close();
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) return false;
+        
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        cqRing = mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        void* entriesAddress = mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || entriesAddress == MAP_FAILED) {
+            if (entriesAddress != MAP_FAILED) munmap(entriesAddress, sqesSize);
+            close();
+            return false;
+        }
+        sqes = static_cast<io_uring_sqe*>(entriesAddress);
+        char* sq = static_cast<char*>(sqRing);
+        char* cq = static_cast<char*>(cqRing);
+        sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    void close() {
+        if (sqes != NULL) munmap(sqes, sqesSize);
+        if (sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+        if (cqRing != MAP_FAILED) munmap(cqRing, cqRingSize);
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        sqRing = cqRing = MAP_FAILED;
+        sqes = NULL;
+        prepared = 0;
+    }
+
+    // Pin `count` buffers for READ_FIXED / WRITE_FIXED (addressed by index)
+    bool registerBuffers(const iovec* buffers, unsigned count) {
+        return syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, buffers, count) == 0;
+    }
+
+    // Next free submission entry, cleared, or NULL when the ring is full
+    io_uring_sqe* prepare(int opcode, int target, unsigned long long userData) {
+        unsigned tail = *sqTail;
+        if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) > sqMask) {
+            return NULL;
+        }
+        io_uring_sqe* entry = &sqes[tail & sqMask];
+        std::memset(entry, 0, sizeof(*entry));
+        entry->opcode = static_cast<unsigned char>(opcode);
+        entry->fd = target;
+        entry->user_data = userData;
+        sqArray[tail & sqMask] = tail & sqMask;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        prepared++;
+        return entry;
+    }
+
+    // Fixed-buffer read or write of registered buffer `index` (offset -1: current position)
+    io_uring_sqe* prepareFixed(int opcode, int target, unsigned index, char* address, size_t length,
+                               unsigned long long offset, unsigned long long userData) {
+        io_uring_sqe* entry = prepare(opcode, target, userData);
+        if (entry != NULL) {
+            entry->addr = reinterpret_cast<unsigned long long>(address);
+            entry->len = static_cast<unsigned>(length);
+            entry->off = offset;
+            entry->buf_index = static_cast<unsigned short>(index);
+        }
+        return entry;
+    }
+
+    // Hand the queued entries to the kernel and wait until `waitFor` completions are ready.
+    // Returns false on an error other than an interrupted wait.
+    bool submit(unsigned waitFor) {
+        unsigned count = prepared;
+        if (count == 0 && waitFor == 0) return true;
+        prepared = 0;
+        long result = syscall(__NR_io_uring_enter, fd, count, waitFor, waitFor > 0 ? IORING_ENTER_GETEVENTS : 0,
+                              NULL, 0);
+        return result >= 0 || errno == EINTR;
+    }
+
+    // Pass every ready completion to onCompletion(userData, result); returns how many
+    template <typename Callback>
+    unsigned reap(Callback onCompletion) {
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        while (head != tail) {
+            io_uring_cqe entry = cqes[head & cqMask];
+            head++;
+            count++;
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+            onCompletion(entry.user_data, entry.res);
+            tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        }
+        return count;
+    }
+};
+
+// Output through io_uring with two registered buffers: one fills while the other is
+// written, so the producer only waits when it fills a buffer before the previous write
+// has completed. Short writes are resubmitted.
+class UringWriter {
+private:
+    IoUring ring;
+    int fd;
+    std::vector<char> storage;
+    char* buffers[2];
+    size_t used[2];
+    int filling;
+    bool writing;               // the other buffer has a write in flight
+    size_t written;             // bytes of the in-flight buffer already written
+    bool failed;
+
+    // Wait for the in-flight write, resubmitting the rest after a short write
+    void waitForWrite() {
+        int writer = 1 - filling;
+        while (writing && !failed) {
+            if (!ring.submit(1)) {
+                failed = true;
+                break;
+            }
+            ring.reap([&](unsigned long long, int result) {
+                if (result <= 0) {
+                    failed = true;
+                    return;
+                }
+                written += static_cast<size_t>(result);
+                if (written == used[writer]) {
+                    writing = false;
+                    used[writer] = 0;
+                } else {
+                    submitWrite(writer);
+                }
+            });
+        }
+    }
+
+    void submitWrite(int index) {
+        if (ring.prepareFixed(IORING_OP_WRITE_FIXED, fd, static_cast<unsigned>(index), buffers[index] + written,
+                              used[index] - written, static_cast<unsigned long long>(-1), 0) == NULL) {
+            failed = true;
+        }
+    }
+
+    void flushFilling() {
+        waitForWrite();
+        if (used[filling] == 0 || failed) return;
+        written = 0;
+        writing = true;
+        submitWrite(filling);
+        ring.submit(0);
+        filling = 1 - filling;
+    }
+
+public:
+    UringWriter() : fd(-1), filling(0), writing(false), written(0), failed(false) {
+        buffers[0] = buffers[1] = NULL;
+        used[0] = used[1] = 0;
+    }
+
+    // False when io_uring is unavailable; the caller falls back to stdio
+    bool open(int target, size_t bufferBytes) {
+        if (!ring.open(4)) return false;
+        storage.assign(2 * bufferBytes, 0);
+        buffers[0] = &storage[0];
+        buffers[1] = &storage[bufferBytes];
+        iovec registered[2];
+        for (int i = 0; i < 2; i++) {
+            registered[i].iov_base = buffers[i];
+            registered[i].iov_len = bufferBytes;
+        }
+        if (!ring.registerBuffers(registered, 2)) {
+            ring.close();
+            return false;
+        }
+        fd = target;
+        return true;
+    }
+
+    void append(const char* data, size_t length) {
+        size_t capacity = storage.size() / 2;
+        while (length > 0 && !failed) {
+            size_t count = std::min(length, capacity - used[filling]);
+            std::memcpy(buffers[filling] + used[filling], data, count);
+            used[filling] += count;
+            data += count;
+            length -= count;
+            if (used[filling] == capacity) {
+                flushFilling();
+            }
+        }
+    }
+
+    // Write everything still buffered; false if any write failed
+    bool finish() {
+        flushFilling();
+        waitForWrite();
+        return !failed;
+    }
+};
+#endif
+
+// Suit-isomorphic key of an ordered matchup: the smallest encoding over all 24 suit relabelings
+long long canonicalMatchupKey(const int hero[2], const int villain[2]) {
+    static const int perms[24][4] = {
+        {0,1,2,3},{0,1,3,2},{0,2,1,3},{0,2,3,1},{0,3,1,2},{0,3,2,1},
+        {1,0,2,3},{1,0,3,2},{1,2,0,3},{1,2,3,0},{1,3,0,2},{1,3,2,0},
+        {2,0,1,3},{2,0,3,1},{2,1,0,3},{2,1,3,0},{2,3,0,1},{2,3,1,0},
+        {3,0,1,2},{3,0,2,1},{3,1,0,2},{3,1,2,0},{3,2,0,1},{3,2,1,0}
+    };
+    long long best = -1;
+    for (int p = 0; p < 24; p++) {
+        int h0 = perms[p][hero[0] / 13] * 13 + hero[0] % 13;
+        int h1 = perms[p][hero[1] / 13] * 13 + hero[1] % 13;
+        int v0 = perms[p][villain[0] / 13] * 13 + villain[0] % 13;
+        int v1 = perms[p][villain[1] / 13] * 13 + villain[1] % 13;
+        if (h0 > h1) std::swap(h0, h1);
+        if (v0 > v1) std::swap(v0, v1);
+        long long key = ((static_cast<long long>(h0) * 52 + h1) * 52 + v0) * 52 + v1;
+        if (best < 0 || key < best) best = key;
+    }
+    return best;
+}
+
+// Offline generator for PreflopEquityTable. Every non-conflicting combo matchup of each class
+// pair is reduced to its suit-isomorphic representative; each representative is enumerated
+// exactly once (1,712,304 boards) on a pool of worker threads, then averaged per class pair.
+bool generatePreflopEquityTable(const std::string& path) {
+    std::vector<std::vector<int> > classCombos(STARTING_HAND_CLASSES);
+    for (int a = 0; a < DECK_SIZE; a++) {
+        for (int b = a + 1; b < DECK_SIZE; b++) {
+            classCombos[startingHandClass(a, b)].push_back(a * DECK_SIZE + b);
+        }
+    }
+    
+    // Unique matchups for hero class < villain class; the mirror entry is 1 - equity
+    std::vector<long long> keys;
+    std::vector<std::vector<std::pair<int, int> > > classPairMatchups;  // (key slot, multiplicity)
+    std::vector<std::pair<int, int> > classPairs;
+    {
+        std::vector<std::pair<long long, int> > slotOf;
+        for (int h = 0; h < STARTING_HAND_CLASSES; h++) {
+            for (int v = h + 1; v < STARTING_HAND_CLASSES; v++) {
+                std::vector<long long> pairKeys;
+                for (size_t i = 0; i < classCombos[h].size(); ++i) {
+                    for (size_t j = 0; j < classCombos[v].size(); ++j) {
+                        int hero[2] = { classCombos[h][i] / DECK_SIZE, classCombos[h][i] % DECK_SIZE };
+                        int villain[2] = { classCombos[v][j] / DECK_SIZE, classCombos[v][j] % DECK_SIZE };
+                        if (hero[0] == villain[0] || hero[0] == villain[1] ||
+                            hero[1] == villain[0] || hero[1] == villain[1]) {
+                            continue;
+                        }
+                        pairKeys.push_back(canonicalMatchupKey(hero, villain));
+                    }
+                }
+                std::sort(pairKeys.begin(), pairKeys.end());
+                classPairs.push_back(std::make_pair(h, v));
+                classPairMatchups.push_back(std::vector<std::pair<int, int> >());
+                for (size_t i = 0; i < pairKeys.size(); ) {
+                    size_t j = i;
+                    while (j < pairKeys.size() && pairKeys[j] == pairKeys[i]) j++;
+                    keys.push_back(pairKeys[i]);
+                    classPairMatchups.back().push_back(std::make_pair(static_cast<int>(keys.size()) - 1,
+                                                                      static_cast<int>(j - i)));
+                    i = j;
+                }
+            }
+        }
+    }
+    
+    // Deduplicate keys across class pairs
+    std::vector<long long> uniqueKeys(keys);
+    std::sort(uniqueKeys.begin(), uniqueKeys.end());
+    uniqueKeys.erase(std::unique(uniqueKeys.begin(), uniqueKeys.end()), uniqueKeys.end());
+    std::vector<double> uniqueEquity(uniqueKeys.size(), 0.0);
+    
+    int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "Enumerating " << uniqueKeys.size() << " canonical matchups on "
+              << threadCount << " threads..." << std::endl;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> done(0);
+    std::mutex printMutex;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threadCount; t++) {
+        workers.push_back(std::thread([&]() {
+            for (size_t k = next++; k < uniqueKeys.size(); k = next++) {
+                long long key = uniqueKeys[k];
+                int hero[2] = { static_cast<int>(key / (52 * 52 * 52)), static_cast<int>(key / (52 * 52) % 52) };
+                int villain[2] = { static_cast<int>(key / 52 % 52), static_cast<int>(key % 52) };
+                std::vector<int> live = liveCardsExcluding(hero, villain);
+                uniqueEquity[k] = enumerateHeadsUpBoards(hero, villain, live, 0,
+                                                         static_cast<int>(live.size())).equity();
+                size_t finished = ++done;
+                if (finished % 1000 == 0) {
+                    std::lock_guard<std::mutex> lock(printMutex);
+                    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    std::cout << "  " << finished << "/" << uniqueKeys.size() << " (" << std::fixed
+                              << std::setprecision(0) << seconds << " s)" << std::endl;
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+    
+    PreflopEquityTable table;
+    for (int c = 0; c < STARTING_HAND_CLASSES; c++) {
+        table.set(c, c, 0.5);
+    }
+    for (size_t p = 0; p < classPairs.size(); ++p) {
+        double sum = 0.0;
+        long long count = 0;
+        for (size_t i = 0; i < classPairMatchups[p].size(); ++i) {
+            long long key = keys[classPairMatchups[p][i].first];
+            size_t slot = std::lower_bound(uniqueKeys.begin(), uniqueKeys.end(), key) - uniqueKeys.begin();
+            sum += uniqueEquity[slot] * classPairMatchups[p][i].second;
+            count += classPairMatchups[p][i].second;
+        }
+        double equity = count > 0 ? sum / count : 0.5;
+        table.set(classPairs[p].first, classPairs[p].second, equity);
+        table.set(classPairs[p].second, classPairs[p].first, 1.0 - equity);
+    }
+    return table.save(path);
+}
+
+// xorshift64* generator for samplers that run on several threads. Each thread owns one
+// (see threadRandom), so workers neither race on nor queue behind the std::rand state.
+class FastRandom {
+private:
+    unsigned long long state;
+
+public:
+    explicit FastRandom(unsigned long long seed) {
+        // splitmix64 spreads nearby seeds apart; xorshift state must be nonzero
+        seed += 0x9E3779B97F4A7C15ULL;
+        seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBULL;
+        state = (seed ^ (seed >> 31)) | 1;
+    }
+
+    unsigned long long next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1DULL;
+    }
+
+    // Uniform integer in [0, n)
+    int below(int n) {
+        return static_cast<int>(((next() >> 32) * static_cast<unsigned long long>(n)) >> 32);
+    }
+};
+
+// The calling thread's generator, seeded from the clock and the order threads first ask
+FastRandom& threadRandom() {
+    static std::atomic<unsigned long long> threadsSeeded(0);
+    thread_local FastRandom random(
+        static_cast<unsigned long long>(std::chrono::steady_clock::now().time_since_epoch().count()) +
+        (threadsSeeded++ << 32));
+    return random;
+}
+
+// Deal one showdown against `opponents` random hands and return the hero's pot share
+// (1 for an outright win, 1/k for a k-way tie, 0 for a loss). `live` holds every card not
+// in the hero's hand or on the board and is reshuffled in place with `random`. The optional
+// ranks are the hero's category and the best opponent category; without opponentRank a loss
+// returns as soon as one opponent beats the hero.
+double simulateMultiwayShowdown(const int hero[2], const std::vector<int>& board,
+                                std::vector<int>& live, int opponents, FastRandom& random,
+                                HandRank* heroRank = NULL, HandRank* opponentRank = NULL) {
+    int missing = 5 - static_cast<int>(board.size());
+    int needed = missing + 2 * opponents;
+    int liveCount = static_cast<int>(live.size());
+    for (int i = 0; i < needed; i++) {
+        int j = i + random.below(liveCount - i);
+        std::swap(live[i], live[j]);
+    }
+    
+    int boardMasks[4] = {0, 0, 0, 0};
+    for (size_t i = 0; i < board.size(); ++i) {
+        boardMasks[board[i] / 13] |= 1 << (board[i] % 13);
+    }
+    for (int i = 0; i < missing; i++) {
+        boardMasks[live[i] / 13] |= 1 << (live[i] % 13);
+    }
+    
+    int hand[4];
+    std::copy(boardMasks, boardMasks + 4, hand);
+    hand[hero[0] / 13] |= 1 << (hero[0] % 13);
+    hand[hero[1] / 13] |= 1 << (hero[1] % 13);
+    int heroStrength = HandEvaluator::evaluateMasks(hand);
+    if (heroRank != NULL) *heroRank = HandEvaluator::packedRank(heroStrength);
+    
+    int tied = 0;
+    int bestOpponent = 0;
+    for (int o = 0; o < opponents; o++) {
+        int a = live[missing + 2 * o];
+        int b = live[missing + 2 * o + 1];
+        std::copy(boardMasks, boardMasks + 4, hand);
+        hand[a / 13] |= 1 << (a % 13);
+        hand[b / 13] |= 1 << (b % 13);
+        int strength = HandEvaluator::evaluateMasks(hand);
+        bestOpponent = std::max(bestOpponent, strength);
+        if (strength > heroStrength && opponentRank == NULL) return 0.0;
+        if (strength == heroStrength) tied++;
+    }
+    if (opponentRank != NULL) *opponentRank = HandEvaluator::packedRank(bestOpponent);
+    return bestOpponent > heroStrength ? 0.0 : 1.0 / (tied + 1);
+}
+
+// Pays out a showdown with main and side pots. Every live hand is evaluated once and the
+// players are sorted by strength; since anyone eligible for a pot layer is eligible for every
+// layer below it, each group of tied players in turn takes the layers from the highest level
+// already paid up to its largest contribution, split among the members who reached each layer.
+class ShowdownResolver {
+public:
+    // holes[p] for each player, contributions to the pot (folded players' chips are dead money)
+    static void resolve(const int boardMasks[4], const int holes[][2], const double* contributions,
+                        const bool* folded, int players, double* payouts) {
+        int strengths[MAX_PLAYERS];
+        for (int p = 0; p < players; p++) {
+            if (folded != NULL && folded[p]) {
+                strengths[p] = -1;
+                continue;
+            }
+            int hand[4];
+            std::copy(boardMasks, boardMasks + 4, hand);
+            hand[holes[p][0] / 13] |= 1 << (holes[p][0] % 13);
+            hand[holes[p][1] / 13] |= 1 << (holes[p][1] % 13);
+            strengths[p] = HandEvaluator::evaluateMasks(hand);
+        }
+        distribute(strengths, contributions, players, payouts);
+    }
+
+    // Payouts from packed strengths (-1 for a folded player)
+    static void distribute(const int* strengths, const double* contributions, int players, double* payouts) {
+        // Strongest first, ties by contribution (insertion sort: at most nine players)
+        int order[MAX_PLAYERS];
+        for (int p = 0; p < players; p++) {
+            payouts[p] = 0.0;
+            int i = p;
+            while (i > 0 && (strengths[order[i - 1]] < strengths[p] ||
+                             (strengths[order[i - 1]] == strengths[p] &&
+                              contributions[order[i - 1]] > contributions[p]))) {
+                order[i] = order[i - 1];
+                i--;
+            }
+            order[i] = p;
+        }
+        
+        double paidLevel = 0.0;
+        int start = 0;
+        while (start < players && strengths[order[start]] >= 0) {
+            int end = start;
+            while (end < players && strengths[order[end]] == strengths[order[start]]) {
+                end++;
+            }
+            // Members are in ascending contribution order; each one closes a layer
+            for (int m = start; m < end; m++) {
+                double level = contributions[order[m]];
+                if (level <= paidLevel) continue;
+                double layer = 0.0;
+                for (int p = 0; p < players; p++) {
+                    layer += std::max(0.0, std::min(contributions[p], level) - paidLevel);
+                }
+                double share = layer / (end - m);
+                for (int w = m; w < end; w++) {
+                    payouts[order[w]] += share;
+                }
+                paidLevel = level;
+            }
+            start = end;
+        }
+        
+        // Chips no live hand could win (above every live contribution) go back to their owners
+        for (int p = 0; p < players; p++) {
+            payouts[p] += std::max(0.0, contributions[p] - paidLevel);
+        }
+    }
+};
+
+// Deal one showdown against `opponents` random hands and return the hero's payout given
+// everyone's contribution to the pot (hero first). Each hand is evaluated once, so this
+// costs the same as simulateMultiwayShowdown without its early exit on a loss.
+double simulateMultiwayPayout(const int hero[2], const std::vector<int>& board, std::vector<int>& live,
+                              int opponents, const double* contributions, FastRandom& random) {
+    int missing = 5 - static_cast<int>(board.size());
+    int needed = missing + 2 * opponents;
+    int liveCount = static_cast<int>(live.size());
+    for (int i = 0; i < needed; i++) {
+        int j = i + random.below(liveCount - i);
+        std::swap(live[i], live[j]);
+    }
+    
+    int boardMasks[4] = {0, 0, 0, 0};
+    for (size_t i = 0; i < board.size(); ++i) {
+        boardMasks[board[i] / 13] |= 1 << (board[i] % 13);
+    }
+    for (int i = 0; i < missing; i++) {
+        boardMasks[live[i] / 13] |= 1 << (live[i] % 13);
+    }
+    
+    int holes[MAX_PLAYERS][2];
+    holes[0][0] = hero[0];
+    holes[0][1] = hero[1];
+    for (int o = 0; o < opponents; o++) {
+        holes[o + 1][0] = live[missing + 2 * o];
+        holes[o + 1][1] = live[missing + 2 * o + 1];
+    }
+    double payouts[MAX_PLAYERS];
+    ShowdownResolver::resolve(boardMasks, holes, contributions, NULL, opponents + 1, payouts);
+    return payouts[0];
+}
+
+// Preflop probability of an outright win (ties count as losses, as in the bot's live
+// simulations) for each starting-hand class against 1-8 random opponents.
+// File layout: "PFMW", uint32 version, uint32 max opponents, then float[maxOpponents][169].
+// The file is memory-mapped and read in place.
+class MultiwayEquityTable {
+private:
+    MappedFile file;
+    const float* probabilities;
+    int maxOpponents;
+
+public:
+    static const unsigned int FILE_VERSION = 2;     // 1 stored split-pot equity
+    static const size_t HEADER_SIZE = 12;
+
+    MultiwayEquityTable() : probabilities(NULL), maxOpponents(0) {}
+
+    bool load(const std::string& path) {
+        probabilities = NULL;
+        maxOpponents = 0;
+        if (!file.open(path) || file.size() < HEADER_SIZE) return false;
+        unsigned int header[2];
+        std::memcpy(header, file.data() + 4, sizeof(header));
+        if (std::memcmp(file.data(), "PFMW", 4) != 0 || header[0] != FILE_VERSION ||
+            header[1] < 1 || header[1] > static_cast<unsigned int>(MAX_OPPONENTS) ||
+            file.size() != HEADER_SIZE + header[1] * STARTING_HAND_CLASSES * sizeof(float)) {
+            file.close();
+            return false;
+        }
+        maxOpponents = static_cast<int>(header[1]);
+        probabilities = reinterpret_cast<const float*>(file.data() + HEADER_SIZE);
+        return true;
+    }
+
+    bool covers(int opponents) const {
+        return probabilities != NULL && opponents >= 1 && opponents <= maxOpponents;
+    }
+
+    double winProbability(int handClass, int opponents) const {
+        return probabilities[(opponents - 1) * STARTING_HAND_CLASSES + handClass];
+    }
+
+    // Offline generator: simulate one representative combo per class (results against random
+    // hands do not depend on the suits chosen), spreading entries over all cores, each with
+    // its own generator
+    static bool generate(const std::string& path, int samples) {
+        std::vector<float> table(MAX_OPPONENTS * STARTING_HAND_CLASSES, 0.0f);
+        std::vector<int> representative(STARTING_HAND_CLASSES * 2, -1);
+        for (int a = 0; a < DECK_SIZE; a++) {
+            for (int b = a + 1; b < DECK_SIZE; b++) {
+                int handClass = startingHandClass(a, b);
+                if (representative[2 * handClass] < 0) {
+                    representative[2 * handClass] = a;
+                    representative[2 * handClass + 1] = b;
+                }
+            }
+        }
+        
+        int threadCount = std::max(1u, std::thread::hardware_concurrency());
+        std::cout << "Simulating " << table.size() << " entries x " << samples << " samples on "
+                  << threadCount << " threads..." << std::endl;
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threadCount; t++) {
+            workers.push_back(std::thread([&]() {
+                FastRandom& random = threadRandom();
+                std::vector<int> board;
+                for (size_t e = next++; e < table.size(); e = next++) {
+                    int opponents = static_cast<int>(e / STARTING_HAND_CLASSES) + 1;
+                    int hero[2] = { representative[2 * (e % STARTING_HAND_CLASSES)],
+                                    representative[2 * (e % STARTING_HAND_CLASSES) + 1] };
+                    std::vector<int> live;
+                    for (int card = 0; card < DECK_SIZE; card++) {
+                        if (card != hero[0] && card != hero[1]) live.push_back(card);
+                    }
+                    long long wins = 0;
+                    for (int n = 0; n < samples; n++) {
+                        if (simulateMultiwayShowdown(hero, board, live, opponents, random) == 1.0) wins++;
+                    }
+                    table[e] = static_cast<float>(static_cast<double>(wins) / samples);
+                }
+            }));
+        }
+        for (size_t t = 0; t < workers.size(); ++t) {
+            workers[t].join();
+        }
+        
+        std::ofstream out(path.c_str(), std::ios::binary);
+        unsigned int header[2] = { FILE_VERSION, static_cast<unsigned int>(MAX_OPPONENTS) };
+        out.write("PFMW", 4);
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(&table[0]), table.size() * sizeof(float));
+        return static_cast<bool>(out);
+    }
+};
+
+// Equity of every hand on one board against a random hand or a weighted range
+struct BoardHeatmap {
+    std::vector<double> comboEquity;   // by comboIndex; -1 for combos that use a board card
+    std::vector<double> classEquity;   // by startingHandClass
+    long long runouts;                 // complete boards examined
+};
+
+// Heatmap for all 1326 combos and 169 classes at once. Every runout (all of them on the
+// flop and later streets, `samples` random ones preflop) gets one strength table over all
+// live combos, shared by every hand. Sorting it once lets each hero combo read its wins
+// and ties against the weighted opponents as prefix sums, with card removal handled by
+// subtracting the per-card sums for the hero's two cards.
+BoardHeatmap computeBoardHeatmap(const std::vector<Card>& board, const std::vector<double>& opponentWeights,
+                                 int samples) {
+    if (board.size() == 1 || board.size() == 2 || board.size() > 5 || opponentWeights.size() != COMBO_COUNT) {
+        throw std::runtime_error("Heatmap needs a 0, 3, 4 or 5 card board and one weight per combo");
+    }
+    TraceSpan span("board heatmap");
+    int boardMasks[4] = {0, 0, 0, 0};
+    unsigned long long boardMask = 0;
+    for (size_t i = 0; i < board.size(); ++i) {
+        int card = board[i].toInt();
+        boardMasks[card / 13] |= 1 << (card % 13);
+        boardMask |= 1ULL << card;
+    }
+    std::vector<int> live;
+    for (int card = 0; card < DECK_SIZE; card++) {
+        if (!(boardMask & (1ULL << card))) live.push_back(card);
+    }
+    int comboCardA[COMBO_COUNT];
+    int comboCardB[COMBO_COUNT];
+    for (int b = 1; b < DECK_SIZE; b++) {
+        for (int a = 0; a < b; a++) {
+            comboCardA[comboIndex(a, b)] = a;
+            comboCardB[comboIndex(a, b)] = b;
+        }
+    }
+    
+    // Runouts: exhaustive when at most two cards are missing, sampled preflop
+    int missing = 5 - static_cast<int>(board.size());
+    std::vector<unsigned long long> runouts;
+    if (missing == 0) {
+        runouts.push_back(0);
+    } else if (missing == 1) {
+        for (size_t i = 0; i < live.size(); ++i) runouts.push_back(1ULL << live[i]);
+    } else if (missing == 2) {
+        for (size_t i = 0; i < live.size(); ++i) {
+            for (size_t j = i + 1; j < live.size(); ++j) runouts.push_back((1ULL << live[i]) | (1ULL << live[j]));
+        }
+    } else {
+        std::vector<int> deck(live);
+        for (int n = 0; n < samples; n++) {
+            unsigned long long mask = 0;
+            for (int i = 0; i < 5; i++) {
+                int j = i + std::rand() % (static_cast<int>(deck.size()) - i);
+                std::swap(deck[i], deck[j]);
+                mask |= 1ULL << deck[i];
+            }
+            runouts.push_back(mask);
+        }
+    }
+    
+    std::vector<double> winShare(COMBO_COUNT, 0.0);
+    std::vector<double> totalWeight(COMBO_COUNT, 0.0);
+    std::vector<int> strengths(COMBO_COUNT, 0);
+    std::vector<int> order;
+    order.reserve(COMBO_COUNT);
+    double cardLess[DECK_SIZE];
+    double cardEqual[DECK_SIZE];
+    double cardTotal[DECK_SIZE];
+    
+    for (size_t r = 0; r < runouts.size(); ++r) {
+        unsigned long long dead = boardMask | runouts[r];
+        int masks[4];
+        std::copy(boardMasks, boardMasks + 4, masks);
+        for (int card = 0; card < DECK_SIZE; card++) {
+            if (runouts[r] & (1ULL << card)) masks[card / 13] |= 1 << (card % 13);
+        }
+        fillComboStrengths(masks, live, runouts[r], &strengths[0]);
+        
+        order.clear();
+        double total = 0.0;
+        std::fill(cardTotal, cardTotal + DECK_SIZE, 0.0);
+        for (int c = 0; c < COMBO_COUNT; c++) {
+            if (dead & ((1ULL << comboCardA[c]) | (1ULL << comboCardB[c]))) continue;
+            order.push_back(c);
+            total += opponentWeights[c];
+            cardTotal[comboCardA[c]] += opponentWeights[c];
+            cardTotal[comboCardB[c]] += opponentWeights[c];
+        }
+        std::sort(order.begin(), order.end(), [&](int x, int y) { return strengths[x] < strengths[y]; });
+        
+        // Walk groups of equal strength, keeping running sums of weaker opponents
+        double less = 0.0;
+        std::fill(cardLess, cardLess + DECK_SIZE, 0.0);
+        std::fill(cardEqual, cardEqual + DECK_SIZE, 0.0);
+        for (size_t g = 0; g < order.size(); ) {
+            size_t end = g;
+            double equal = 0.0;
+            while (end < order.size() && strengths[order[end]] == strengths[order[g]]) {
+                int c = order[end++];
+                equal += opponentWeights[c];
+                cardEqual[comboCardA[c]] += opponentWeights[c];
+                cardEqual[comboCardB[c]] += opponentWeights[c];
+            }
+            for (size_t k = g; k < end; k++) {
+                int c = order[k];
+                int a = comboCardA[c];
+                int b = comboCardB[c];
+                double self = opponentWeights[c];
+                double wins = less - cardLess[a] - cardLess[b];
+                double ties = equal - cardEqual[a] - cardEqual[b] + self;
+                winShare[c] += wins + 0.5 * ties;
+                totalWeight[c] += total - cardTotal[a] - cardTotal[b] + self;
+            }
+            for (size_t k = g; k < end; k++) {
+                int c = order[k];
+                less += opponentWeights[c];
+                cardLess[comboCardA[c]] += opponentWeights[c];
+                cardLess[comboCardB[c]] += opponentWeights[c];
+                cardEqual[comboCardA[c]] = 0.0;
+                cardEqual[comboCardB[c]] = 0.0;
+            }
+            g = end;
+        }
+    }
+    
+    BoardHeatmap heatmap;
+    heatmap.runouts = static_cast<long long>(runouts.size());
+    heatmap.comboEquity.assign(COMBO_COUNT, -1.0);
+    heatmap.classEquity.assign(STARTING_HAND_CLASSES, -1.0);
+    std::vector<double> classWin(STARTING_HAND_CLASSES, 0.0);
+    std::vector<double> classTotal(STARTING_HAND_CLASSES, 0.0);
+    for (int c = 0; c < COMBO_COUNT; c++) {
+        if (totalWeight[c] <= 0) continue;
+        heatmap.comboEquity[c] = winShare[c] / totalWeight[c];
+        int handClass = startingHandClass(comboCardA[c], comboCardB[c]);
+        classWin[handClass] += winShare[c];
+        classTotal[handClass] += totalWeight[c];
+    }
+    for (int h = 0; h < STARTING_HAND_CLASSES; h++) {
+        if (classTotal[h] > 0) heatmap.classEquity[h] = classWin[h] / classTotal[h];
+    }
+    return heatmap;
+}
+
+// A decision query submitted to a QueryExecutor
+struct EquityQuery {
+    int id;
+    std::vector<Card> holeCards;
+    std::vector<Card> communityCards;
+    int opponents;
+    long long targetSimulations;
+    int deadlineMs;              // relative to submission
+
+    EquityQuery() : id(0), opponents(1), targetSimulations(0), deadlineMs(0) {}
+};
+
+struct EquityResult {
+    int id;
+    long long simulations;
+    double winProbability;       // the bot's estimate: outright wins, ties count as losses
+    bool deadlineMissed;         // stopped by the deadline before reaching the target
+
+    EquityResult() : id(0), simulations(0), winProbability(0.0), deadlineMissed(false) {}
+};
+
+// Monotonic arena for one query's temporaries. Allocation bumps a pointer; release()
+// drops everything in O(1) and keeps the blocks, so a recycled arena allocates without
+// touching malloc. Arenas are handed out from a per-thread free list, which keeps query
+// setup and teardown off the global allocator's locks.
+class QueryArena {
+private:
+    std::vector<char*> blocks;
+    std::vector<size_t> blockSizes;
+    size_t current;      // block being filled
+    size_t offset;       // bytes used in the current block
+
+    QueryArena(const QueryArena&);
+    QueryArena& operator=(const QueryArena&);
+
+    // Idle arenas of the calling thread, freed when the thread exits
+    struct FreeList {
+        std::vector<QueryArena*> arenas;
+
+        ~FreeList() {
+            for (size_t i = 0; i < arenas.size(); ++i) {
+                delete arenas[i];
+            }
+        }
+    };
+
+    static std::vector<QueryArena*>& freeList() {
+        thread_local FreeList list;
+        return list.arenas;
+    }
+
+public:
+    QueryArena() : current(0), offset(0) {}
+
+    ~QueryArena() {
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            delete[] blocks[i];
+        }
+    }
+
+    void* allocate(size_t bytes, size_t alignment) {
+        while (true) {
+            if (current < blocks.size()) {
+                size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+                if (aligned + bytes <= blockSizes[current]) {
+                    offset = aligned + bytes;
+                    return blocks[current] + aligned;
+                }
+                if (current + 1 < blocks.size()) {
+                    current++;
+                    offset = 0;
+                    continue;
+                }
+            }
+            // Grow geometrically; new blocks are kept for later queries
+            size_t size = std::max(bytes + alignment, blocks.empty() ? QUERY_ARENA_BLOCK_BYTES : blockSizes.back() * 2);
+            blocks.push_back(new char[size]);
+            blockSizes.push_back(size);
+            current = blocks.size() - 1;
+            offset = 0;
+        }
+    }
+
+    void release() {
+        current = 0;
+        offset = 0;
+    }
+
+    // Take an arena from this thread's free list (or a new one)
+    static QueryArena* acquire() {
+        std::vector<QueryArena*>& arenas = freeList();
+        if (arenas.empty()) {
+            return new QueryArena();
+        }
+        QueryArena* arena = arenas.back();
+        arenas.pop_back();
+        return arena;
+    }
+
+    // Release an arena's contents and return it to this thread's free list
+    static void recycle(QueryArena* arena) {
+        arena->release();
+        std::vector<QueryArena*>& arenas = freeList();
+        if (arenas.size() < QUERY_ARENA_FREE_LIST_MAX) {
+            arenas.push_back(arena);
+        } else {
+            delete arena;
+        }
+    }
+};
+
+// Standard allocator over a QueryArena; deallocation is a no-op until the arena is released
+template <typename T>
+struct ArenaAllocator {
+    typedef T value_type;
+
+    QueryArena* arena;
+
+    explicit ArenaAllocator(QueryArena* source) : arena(source) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const {
+        return arena == other.arena;
+    }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const {
+        return arena != other.arena;
+    }
+};
+
+// Long-lived storage for an executor's own containers: a QueryArena that is never released,
+// plus free lists by 16-byte size class so small blocks (map nodes) freed as queries finish
+// are reused. Larger blocks (vector growth) stay in the arena, at most twice the peak size.
+class RecyclingArena {
+private:
+    QueryArena arena;
+    void* freeLists[QUERY_RECYCLE_SIZE_CLASSES];
+
+    static size_t sizeClass(size_t bytes) {
+        return (bytes + 15) / 16;
+    }
+
+public:
+    RecyclingArena() {
+        std::fill(freeLists, freeLists + QUERY_RECYCLE_SIZE_CLASSES, static_cast<void*>(NULL));
+    }
+
+    void* allocate(size_t bytes, size_t alignment) {
+        size_t index = sizeClass(bytes);
+        if (index < QUERY_RECYCLE_SIZE_CLASSES && alignment <= 16) {
+            if (freeLists[index] != NULL) {
+                void* block = freeLists[index];
+                freeLists[index] = *static_cast<void**>(block);
+                return block;
+            }
+            return arena.allocate(std::max<size_t>(index * 16, sizeof(void*)), 16);
+        }
+        return arena.allocate(bytes, alignment);
+    }
+
+    void deallocate(void* block, size_t bytes, size_t alignment) {
+        size_t index = sizeClass(bytes);
+        if (index < QUERY_RECYCLE_SIZE_CLASSES && alignment <= 16) {
+            *static_cast<void**>(block) = freeLists[index];
+            freeLists[index] = block;
+        }
+    }
+};
+
+// Standard allocator over a RecyclingArena
+template <typename T>
+struct RecyclingAllocator {
+    typedef T value_type;
+
+    RecyclingArena* arena;
+
+    explicit RecyclingAllocator(RecyclingArena* source) : arena(source) {}
+
+    template <typename U>
+    RecyclingAllocator(const RecyclingAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* block, size_t count) {
+        arena->deallocate(block, count * sizeof(T), alignof(T));
+    }
+
+    template <typename U>
+    bool operator==(const RecyclingAllocator<U>& other) const {
+        return arena == other.arena;
+    }
+
+    template <typename U>
+    bool operator!=(const RecyclingAllocator<U>& other) const {
+        return arena != other.arena;
+    }
+};
+
+// Suit-isomorphic key of a spot: hole cards and board as sets, minimised over all 24 suit
+// relabelings, plus the opponent count. Spots with equal keys have equal equity. The optional
+// suitMap receives the minimising relabeling (actual suit -> canonical suit).
+unsigned long long canonicalSpotKey(const int hero[2], const int* board, int boardSize, int opponents,
+                                    int* suitMap = NULL) {
+    static const int perms[24][4] = {
+        {0,1,2,3},{0,1,3,2},{0,2,1,3},{0,2,3,1},{0,3,1,2},{0,3,2,1},
+        {1,0,2,3},{1,0,3,2},{1,2,0,3},{1,2,3,0},{1,3,0,2},{1,3,2,0},
+        {2,0,1,3},{2,0,3,1},{2,1,0,3},{2,1,3,0},{2,3,0,1},{2,3,1,0},
+        {3,0,1,2},{3,0,2,1},{3,1,0,2},{3,1,2,0},{3,2,0,1},{3,2,1,0}
+    };
+    unsigned long long best = 0;
+    for (int p = 0; p < 24; p++) {
+        int h[2];
+        int b[5];
+        for (int i = 0; i < 2; i++) h[i] = perms[p][hero[i] / 13] * 13 + hero[i] % 13;
+        for (int i = 0; i < boardSize; i++) b[i] = perms[p][board[i] / 13] * 13 + board[i] % 13;
+        if (h[0] > h[1]) std::swap(h[0], h[1]);
+        for (int i = 1; i < boardSize; i++) {
+            for (int j = i; j > 0 && b[j - 1] > b[j]; j--) std::swap(b[j - 1], b[j]);
+        }
+        unsigned long long key = 0;
+        for (int i = 0; i < 2; i++) key = (key << 6) | h[i];
+        for (int i = 0; i < boardSize; i++) key = (key << 6) | b[i];
+        if (p == 0 || key < best) {
+            best = key;
+            if (suitMap != NULL) std::copy(perms[p], perms[p] + 4, suitMap);
+        }
+    }
+    return (best << 7) | (static_cast<unsigned long long>(boardSize) << 4) | opponents;
+}
+
+// Serialized ISMCTS trees keyed by canonical spot. File layout: "PFBK", uint32 version,
+// uint32 spot count, uint32 node count, the BookModel (double pot odds, uint64 leaf model
+// fingerprint), then BookSpot[spots] sorted by key and BookNode[nodes]. The file is
+// memory-mapped and read in place, so processes using the same book share it through the
+// page cache.
+struct BookSpot {
+    unsigned long long key;
+    unsigned int firstNode;
+    unsigned int nodeCount;
+};
+
+class OpeningBook {
+private:
+    MappedFile file;
+    const BookSpot* spots;
+    const BookNode* nodes;
+    unsigned int spotCount;
+    unsigned int nodeCount;
+    BookModel model;
+
+public:
+    static const unsigned int FILE_VERSION = 2;   // 2: the BookModel header fields
+    static const size_t HEADER_SIZE = 32;
+
+    OpeningBook() : spots(NULL), nodes(NULL), spotCount(0), nodeCount(0) {
+        model.potOdds = -1.0;
+        model.leafFingerprint = 0;
+    }
+
+    bool load(const std::string& path) {
+        if (!file.open(path) || file.size() < HEADER_SIZE) {
+            return false;
+        }
+        unsigned int header[3];
+        std::memcpy(header, file.data() + 4, sizeof(header));
+        if (std::memcmp(file.data(), "PFBK", 4) != 0 || header[0] != FILE_VERSION ||
+            file.size() != HEADER_SIZE + header[1] * sizeof(BookSpot) + header[2] * sizeof(BookNode)) {
+            file.close();
+            return false;
+        }
+        spotCount = header[1];
+        nodeCount = header[2];
+        std::memcpy(&model.potOdds, file.data() + 16, sizeof(model.potOdds));
+        std::memcpy(&model.leafFingerprint, file.data() + 24, sizeof(model.leafFingerprint));
+        spots = reinterpret_cast<const BookSpot*>(file.data() + HEADER_SIZE);
+        nodes = reinterpret_cast<const BookNode*>(file.data() + HEADER_SIZE + spotCount * sizeof(BookSpot));
+        return true;
+    }
+
+    // Tree stored for a canonical spot key, or NULL
+    const BookNode* find(unsigned long long key, size_t& count) const {
+        const BookSpot* end = spots + spotCount;
+        const BookSpot* spot = std::lower_bound(spots, end, key,
+                                                [](const BookSpot& entry, unsigned long long k) { return entry.key < k; });
+        if (spot == end || spot->key != key || spot->firstNode + static_cast<unsigned long long>(spot->nodeCount) > nodeCount) {
+            return NULL;
+        }
+        count = spot->nodeCount;
+        return nodes + spot->firstNode;
+    }
+
+    unsigned int getSpotCount() const {
+        return spotCount;
+    }
+
+    // Settings the book's trees were searched under
+    const BookModel& getModel() const {
+        return model;
+    }
+
+    static bool save(const std::string& path, const BookModel& bookModel, std::vector<BookSpot> bookSpots,
+                     const std::vector<BookNode>& bookNodes) {
+        std::sort(bookSpots.begin(), bookSpots.end(),
+                  [](const BookSpot& a, const BookSpot& b) { return a.key < b.key; });
+        std::ofstream out(path.c_str(), std::ios::binary);
+        unsigned int header[3] = {FILE_VERSION, static_cast<unsigned int>(bookSpots.size()),
+                                  static_cast<unsigned int>(bookNodes.size())};
+        out.write("PFBK", 4);
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(&bookModel.potOdds), sizeof(bookModel.potOdds));
+        out.write(reinterpret_cast<const char*>(&bookModel.leafFingerprint), sizeof(bookModel.leafFingerprint));
+        if (!bookSpots.empty()) {
+            out.write(reinterpret_cast<const char*>(&bookSpots[0]), bookSpots.size() * sizeof(BookSpot));
+        }
+        if (!bookNodes.empty()) {
+            out.write(reinterpret_cast<const char*>(&bookNodes[0]), bookNodes.size() * sizeof(BookNode));
+        }
+        return static_cast<bool>(out);
+    }
+};
+
+// Simulation outcomes tallied by each side's final hand category. Fixed-size arrays so a
+// simulation loop can keep its own copy and merge it once at the end.
+struct OutcomeBreakdown {
+    long long byBotRank[10][2];        // [category][bot won]
+    long long byOpponentRank[10][2];   // [category][bot won]
+
+    OutcomeBreakdown() {
+        clear();
+    }
+
+    void clear() {
+        for (int r = 0; r < 10; r++) {
+            byBotRank[r][0] = byBotRank[r][1] = 0;
+            byOpponentRank[r][0] = byOpponentRank[r][1] = 0;
+        }
+    }
+
+    void record(HandRank botRank, HandRank opponentRank, bool won) {
+        byBotRank[botRank][won]++;
+        byOpponentRank[opponentRank][won]++;
+    }
+
+    void merge(const OutcomeBreakdown& other) {
+        for (int r = 0; r < 10; r++) {
+            for (int w = 0; w < 2; w++) {
+                byBotRank[r][w] += other.byBotRank[r][w];
+                byOpponentRank[r][w] += other.byOpponentRank[r][w];
+            }
+        }
+    }
+};
+
+// Cost accounting for one decision, written as one JSONL line
+struct DecisionRecord {
+    std::string holeCards;
+    std::string communityCards;
+    double cpuMs;
+    double wallMs;
+    long long simulations;
+    long long totalSimulations;   // including earlier calls this one resumed
+    long long cacheHits;
+    int threads;
+    double winProbability;
+    double ciLow;
+    double ciHigh;
+    double deadlineSlackMs;   // negative when the deadline was overrun
+
+    DecisionRecord() : cpuMs(0), wallMs(0), simulations(0), totalSimulations(0), cacheHits(0), threads(1),
+                       winProbability(0), ciLow(0), ciHigh(0), deadlineSlackMs(0) {}
+
+    std::string toJson() const {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(4)
+            << "{\"hole\":\"" << holeCards << "\",\"board\":\"" << communityCards
+            << "\",\"cpu_ms\":" << cpuMs << ",\"wall_ms\":" << wallMs
+            << ",\"simulations\":" << simulations << ",\"total_simulations\":" << totalSimulations
+            << ",\"cache_hits\":" << cacheHits
+            << ",\"threads\":" << threads << ",\"win_probability\":" << winProbability
+            << ",\"ci95\":[" << ciLow << "," << ciHigh << "]"
+            << ",\"deadline_slack_ms\":" << deadlineSlackMs << "}";
+        return out.str();
+    }
+};
+
+// CPU time of the calling thread in milliseconds. Decisions on other threads are not
+// counted; without a per-thread clock this falls back to the whole process.
+double threadCpuMs() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+#else
+    return clock() * 1000.0 / CLOCKS_PER_SEC;
+#endif
+}
+
+// 95% Wilson score interval for a binomial proportion
+void wilsonInterval(double wins, double trials, double& low, double& high) {
+    if (trials <= 0) {
+        low = 0.0;
+        high = 1.0;
+        return;
+    }
+    const double z = 1.96;
+    double p = wins / trials;
+    double denominator = 1.0 + z * z / trials;
+    double center = (p + z * z / (2.0 * trials)) / denominator;
+    double margin = z * std::sqrt(p * (1.0 - p) / trials + z * z / (4.0 * trials * trials)) / denominator;
+    low = std::max(0.0, center - margin);
+    high = std::min(1.0, center + margin);
+}
+
+// Join cards as a space-separated string
+std::string cardsToString(const std::vector<Card>& cards) {
+    std::string result;
+    for (size_t i = 0; i < cards.size(); ++i) {
+        if (i > 0) result += " ";
+        result += cards[i].toString();
+    }
+    return result;
+}
+
+// How runMCTS spends its budget
+enum SearchMode {
+    SEARCH_EQUITY,      // flat showdown sampling into the root node
+    SEARCH_ISMCTS       // information-set tree over the bot's later stay/fold decisions
+};
+
+// Monte Carlo Tree Search Poker Bot
+class PokerBot {
+private:
+    PokerGame game;
+    std::vector<Card> myCards;
+    std::vector<Card> community;
+    
+    // Keep track of runs for statistics
+    int totalRuns;
+    int winningRuns;
+    MCTSNode rootNode;
+    
+    // Per-runout strength tables for flop and turn decisions
+    BoardStrengthCache strengthCache;
+    
+    // Outcomes of the last runMCTS call by final hand category
+    OutcomeBreakdown breakdown;
+    
+    // Number of opponents still in the hand; preflop multiway spots are answered
+    // from the precomputed table when one is loaded
+    int opponentCount;
+    const MultiwayEquityTable* multiwayTable;
+    bool answeredFromTable;
+    double tableWinProbability;
+    
+    // Card sets for showdowns sampled directly (no strength tables or search)
+    int showdownHero[2];
+    std::vector<int> showdownBoard;
+    std::vector<int> showdownLive;
+    
+    // Per-decision cost records (optional)
+    AsyncLineWriter* recordWriter;
+    DecisionRecord lastRecord;
+    
+    SearchMode searchMode;
+    InfoSetSearch search;
+    
+    // Precomputed trees that seed ISMCTS searches (optional)
+    const OpeningBook* openingBook;
+    
+    // Situation the accumulated statistics belong to (for resumed runs)
+    std::vector<Card> statsHoleCards;
+    std::vector<Card> statsCommunity;
+    int statsOpponents;
+    SearchMode statsMode;
+    
+    // How the open decision samples, and where it started (see beginDecision)
+    bool strengthTables;
+    bool useSearch;
+    bool useTables;
+    int decisionStartRuns;
+    long long decisionStartHits;
+    long long decisionStartBuilds;
+    std::chrono::steady_clock::time_point decisionWallStart;
+    double decisionCpuStart;      // threadCpuMs() when the decision opened
+    long long chunkStartUs;
+    int chunkStartRuns;
+    
+public:
+    // Simulations draw from threadRandom(), so bots may be created and run on any thread
+    PokerBot() : totalRuns(0), winningRuns(0), opponentCount(1), multiwayTable(NULL),
+                 answeredFromTable(false), tableWinProbability(0.0), recordWriter(NULL),
+                 searchMode(SEARCH_EQUITY), openingBook(NULL), statsOpponents(0), statsMode(SEARCH_EQUITY),
+                 strengthTables(true), useSearch(false), useTables(false), decisionStartRuns(0),
+                 decisionStartHits(0), decisionStartBuilds(0), decisionCpuStart(0), chunkStartUs(0),
+                 chunkStartRuns(0) {}
+    
+    // Set the bot's hole cards and any known community cards
+    void setKnownCards(const std::vector<Card>& holeCards, const std::vector<Card>& communityCards) {
         myCards = holeCards;
         community = communityCards;
     }
     
-    // Get the bot's hole cards
-    const std::vector<Card>& getHoleCards() const {
-        return myCards;
+    // Number of opponents in the hand (1-8)
+    void setOpponentCount(int opponents) {
+        opponentCount = std::max(1, std::min(opponents, MAX_OPPONENTS));
+    }
+    
+    // Table used for multiway preflop decisions (NULL to always simulate)
+    void setMultiwayTable(const MultiwayEquityTable* table) {
+        multiwayTable = table;
+    }
+    
+    // Flat equity sampling (default) or information-set MCTS
+    void setSearchMode(SearchMode mode) {
+        searchMode = mode;
+    }
+    
+    // Opponent policy for ISMCTS rollouts at the given price to call (NULL: opponents never fold)
+    void setRolloutPolicy(const RolloutPolicy* policy, double potOdds) {
+        search.setRolloutPolicy(policy, potOdds);
+    }
+    
+    // Book whose tree for the current spot, if any, seeds each new ISMCTS search (NULL disables).
+    // Searches only seed from it while the rollout policy and leaf model match its model.
+    void setOpeningBook(const OpeningBook* book) {
+        openingBook = book;
+    }
+    
+    // Rollout policy and leaf model of this bot's ISMCTS searches
+    BookModel getSearchModel() const {
+        return search.model();
+    }
+    
+    // Per-board strength tables for heads-up flop and turn decisions (on by default). They
+    // are faster than direct showdowns but can grow to a few MB per board.
+    void setStrengthTables(bool enabled) {
+        strengthTables = enabled;
+    }
+    
+    // Most ISMCTS tree nodes kept at once (least-visited subtrees are pruned beyond it)
+    void setNodeBudget(size_t budget) {
+        search.setNodeBudget(budget);
+    }
+    
+    // Model that values new ISMCTS leaves instead of rolling them out (NULL disables)
+    void setLeafEvaluator(const LeafEvaluator* evaluator) {
+        search.setLeafEvaluator(evaluator);
+    }
+    
+    // Emit a DecisionRecord line for every runMCTS call (NULL disables)
+    void setRecordWriter(AsyncLineWriter* writer) {
+        recordWriter = writer;
+    }
+    
+    // Cost accounting for the most recent runMCTS call
+    const DecisionRecord& getLastDecisionRecord() const {
+        return lastRecord;
+    }
+    
+    // Get the bot's hole cards
+    const std::vector<Card>& getHoleCards() const {
+        return myCards;
+    }
+    
+    // Get the community cards
+    const std::vector<Card>& getCommunityCards() const {
+        return community;
+    }
+    
+    // True when the accumulated statistics were gathered for the current cards and settings
+    bool statisticsMatchSituation() const {
+        return totalRuns > 0 && statsHoleCards == myCards && statsCommunity == community &&
+               statsOpponents == opponentCount && statsMode == searchMode;
+    }
+    
+    // Open a decision for the current cards: reset the statistics (unless `resume` and the
+    // situation is unchanged) and choose how simulate() samples. Multiway preflop spots
+    // covered by the table are answered from it and need no simulations.
+    void beginDecision(bool resume = false) {
+        decisionWallStart = std::chrono::steady_clock::now();
+        decisionCpuStart = threadCpuMs();
+        bool resumed = resume && statisticsMatchSituation();
+        if (!resumed) {
+            totalRuns = 0;
+            winningRuns = 0;
+            
+            // Create root node
+            rootNode = MCTSNode();
+            breakdown.clear();
+            statsHoleCards = myCards;
+            statsCommunity = community;
+            statsOpponents = opponentCount;
+            statsMode = searchMode;
+        }
+        decisionStartRuns = totalRuns;
+        
+        // Multiway preflop spots never simulate when the table covers them
+        answeredFromTable = opponentCount > 1 && community.empty() && myCards.size() == 2 &&
+                            multiwayTable != NULL && multiwayTable->covers(opponentCount);
+        if (answeredFromTable) {
+            tableWinProbability = multiwayTable->winProbability(
+                startingHandClass(myCards[0].toInt(), myCards[1].toInt()), opponentCount);
+        }
+        useSearch = searchMode == SEARCH_ISMCTS && !answeredFromTable;
+        if (useSearch && !resumed) {
+            search.reset(myCards, community, opponentCount);
+            if (openingBook != NULL) {
+                seedSearchFromBook();
+            }
+        }
+        
+        useTables = !useSearch && strengthTables && opponentCount == 1 &&
+                    BoardStrengthCache::applicable(myCards, community);
+        if (useTables) {
+            strengthCache.prepare(myCards, community);
+        } else if (!useSearch) {
+            prepareShowdowns();
+        }
+        decisionStartHits = strengthCache.getHits();
+        decisionStartBuilds = strengthCache.getBuilds();
+        
+        chunkStartUs = Tracer::enabled() ? Tracer::nowUs() : 0;
+        chunkStartRuns = totalRuns;
+    }
+    
+    // Run `count` more simulations of the open decision
+    void simulate(long long count) {
+        if (answeredFromTable) return;
+        
+        // Tallied locally and merged once the chunk ends
+        OutcomeBreakdown localBreakdown;
+        HandRank botRank = HIGH_CARD;
+        HandRank opponentRank = HIGH_CARD;
+        bool tracing = Tracer::enabled();
+        
+        for (long long n = 0; n < count; n++) {
+            bool won;
+            bool showdown = true;
+            if (useSearch) {
+                won = search.iterate(botRank, opponentRank, showdown) >= 1.0;
+            } else if (useTables) {
+                won = strengthCache.simulate(botRank, opponentRank);
+            } else {
+                won = runShowdownSimulation(&botRank, &opponentRank);
+            }
+            if (showdown) {
+                localBreakdown.record(botRank, opponentRank, won);
+            }
+            rootNode.update(won);
+            
+            totalRuns++;
+            if (won) {
+                winningRuns++;
+            }
+            
+            if (tracing && totalRuns - chunkStartRuns == TRACE_CHUNK_SIMULATIONS) {
+                Tracer::record("simulation chunk", chunkStartUs, totalRuns - chunkStartRuns);
+                chunkStartUs = Tracer::nowUs();
+                chunkStartRuns = totalRuns;
+            }
+        }
+        
+        breakdown.merge(localBreakdown);
+    }
+    
+    // Record of the open decision's cards, simulations, cache hits and estimate with its
+    // interval; the caller fills in the costs (CPU, wall time, simulations of this call, slack)
+    DecisionRecord decisionSummary() const {
+        DecisionRecord record;
+        record.holeCards = cardsToString(myCards);
+        record.communityCards = cardsToString(community);
+        record.simulations = totalRuns - decisionStartRuns;
+        record.totalSimulations = totalRuns;
+        record.cacheHits = strengthCache.getHits() - decisionStartHits;
+        record.winProbability = getWinProbability();
+        if (useSearch) {
+            search.stayInterval(record.ciLow, record.ciHigh);
+        } else {
+            wilsonInterval(winningRuns, totalRuns, record.ciLow, record.ciHigh);
+        }
+        if (answeredFromTable) {
+            record.ciLow = record.ciHigh = tableWinProbability;
+        }
+        return record;
+    }
+    
+    // Close the open decision against its time limit: update the metrics, fill in the
+    // decision record (written when a record writer is set) and return the win probability
+    double finishDecision(int msTimeLimit) {
+        int callRuns = totalRuns - decisionStartRuns;
+        if (Tracer::enabled() && totalRuns > chunkStartRuns) {
+            Tracer::record("simulation chunk", chunkStartUs, totalRuns - chunkStartRuns);
+        }
+        
+        double wallMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - decisionWallStart).count();
+        Metrics::add(METRIC_SIMULATIONS, callRuns);
+        Metrics::add(METRIC_DECISIONS);
+        long long cacheHits = strengthCache.getHits() - decisionStartHits;
+        Metrics::add(METRIC_CACHE_HITS, cacheHits);
+        Metrics::add(METRIC_CACHE_MISSES, strengthCache.getBuilds() - decisionStartBuilds);
+        if (wallMs > msTimeLimit + DEADLINE_MISS_TOLERANCE_MS) {
+            Metrics::add(METRIC_DEADLINE_MISSES);
+        }
+        Metrics::observeLatency(currentStreet(), wallMs);
+        if (wallMs > 0) {
+            Metrics::setSimulationsPerSecond(callRuns * 1000.0 / wallMs);
+        }
+        
+        lastRecord = decisionSummary();
+        lastRecord.cpuMs = threadCpuMs() - decisionCpuStart;
+        lastRecord.wallMs = wallMs;
+        lastRecord.simulations = callRuns;
+        lastRecord.deadlineSlackMs = msTimeLimit - wallMs;
+        if (recordWriter != NULL) {
+            recordWriter->write(lastRecord.toJson());
+        }
+        
+        return getWinProbability();
+    }
+    
+    // Run Monte Carlo simulations for a specified time limit. With `resume`, runs for an
+    // unchanged situation add to the statistics (and ISMCTS tree) of the previous calls, so
+    // a budget can be spent in several small calls; otherwise they start from zero.
+    double runMCTS(int msTimeLimit, bool resume = false) {
+        TraceSpan decisionSpan("decision");
+        beginDecision(resume);
+        int simulationBudgetMs = answeredFromTable ? 0 : msTimeLimit;
+        
+        // Check the time limit in wall time, the same clock deadline misses are measured on
+        while (std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - decisionWallStart).count() < simulationBudgetMs) {
+            simulate(TIME_CHECK_INTERVAL);
+        }
+        
+        decisionSpan.setArg(totalRuns - decisionStartRuns);
+        return finishDecision(msTimeLimit);
+    }
+    
+    // Simulations behind the current statistics (including resumed calls)
+    long long getSimulationCount() const {
+        return totalRuns;
+    }
+    
+    // Win probability of each candidate holding on the current board, with every candidate
+    // scored against the same sampled runouts and opponent hands (common random numbers).
+    // Differences between candidates have far lower variance than separate runs, and
+    // each sample is dealt and the opponent evaluated once. Samples that collide with a
+    // candidate's own cards are skipped for that candidate only. Candidates may not share
+    // a card with the board or with each other.
+    std::vector<double> compareHoldings(const std::vector<std::vector<Card> >& candidates, int samples) const {
+        std::vector<int> board;
+        long long usedMask = 0;
+        if (community.size() > 5) {
+            throw std::runtime_error("A board has at most five cards");
+        }
+        for (size_t i = 0; i < community.size(); ++i) {
+            if (usedMask & (1LL << community[i].toInt())) {
+                throw std::runtime_error("Board card " + community[i].toString() + " appears twice");
+            }
+            board.push_back(community[i].toInt());
+            usedMask |= 1LL << community[i].toInt();
+        }
+        std::vector<int> live;
+        for (int card = 0; card < DECK_SIZE; card++) {
+            if (std::find(board.begin(), board.end(), card) == board.end()) {
+                live.push_back(card);
+            }
+        }
+        
+        std::vector<long long> candidateMasks(candidates.size(), 0);
+        std::vector<int> candidateCards;
+        for (size_t c = 0; c < candidates.size(); ++c) {
+            if (candidates[c].size() != 2) {
+                throw std::runtime_error("Candidate holdings must have exactly two cards");
+            }
+            for (size_t i = 0; i < 2; ++i) {
+                long long bit = 1LL << candidates[c][i].toInt();
+                if (usedMask & bit) {
+                    throw std::runtime_error("Candidate card " + candidates[c][i].toString() +
+                                             " is already on the board or in another candidate");
+                }
+                usedMask |= bit;
+                candidateMasks[c] |= bit;
+                candidateCards.push_back(candidates[c][i].toInt());
+            }
+        }
+        
+        std::vector<long long> wins(candidates.size(), 0);
+        std::vector<long long> valid(candidates.size(), 0);
+        int missing = 5 - static_cast<int>(board.size());
+        int needed = missing + 2;
+        int liveCount = static_cast<int>(live.size());
+        
+        for (int n = 0; n < samples; n++) {
+            // Partial Fisher-Yates over the live cards
+            for (int i = 0; i < needed; i++) {
+                int j = i + std::rand() % (liveCount - i);
+                std::swap(live[i], live[j]);
+            }
+            
+            int boardMasks[4] = {0, 0, 0, 0};
+            for (size_t i = 0; i < board.size(); ++i) {
+                boardMasks[board[i] / 13] |= 1 << (board[i] % 13);
+            }
+            long long sampledMask = 0;
+            for (int i = 0; i < missing; i++) {
+                boardMasks[live[i] / 13] |= 1 << (live[i] % 13);
+                sampledMask |= 1LL << live[i];
+            }
+            
+            int hand[4];
+            std::copy(boardMasks, boardMasks + 4, hand);
+            for (int i = missing; i < needed; i++) {
+                hand[live[i] / 13] |= 1 << (live[i] % 13);
+                sampledMask |= 1LL << live[i];
+            }
+            int opponentStrength = HandEvaluator::evaluateMasks(hand);
+            
+            for (size_t c = 0; c < candidates.size(); ++c) {
+                if (candidateMasks[c] & sampledMask) continue;
+                std::copy(boardMasks, boardMasks + 4, hand);
+                for (int i = 0; i < 2; i++) {
+                    int card = candidateCards[2 * c + i];
+                    hand[card / 13] |= 1 << (card % 13);
+                }
+                valid[c]++;
+                if (HandEvaluator::evaluateMasks(hand) > opponentStrength) {
+                    wins[c]++;
+                }
+            }
+        }
+        
+        std::vector<double> probabilities(candidates.size(), 0.0);
+        for (size_t c = 0; c < candidates.size(); ++c) {
+            if (valid[c] > 0) {
+                probabilities[c] = static_cast<double>(wins[c]) / valid[c];
+            }
+        }
+        return probabilities;
+    }
+    
+    // Start the search from the book's tree for this spot, relabeled to its suits. Trees
+    // searched under another rollout policy or leaf model estimate a different value.
+    void seedSearchFromBook() {
+        if (!(openingBook->getModel() == search.model())) {
+            return;
+        }
+        int hero[2] = {myCards[0].toInt(), myCards[1].toInt()};
+        int board[5] = {0, 0, 0, 0, 0};
+        for (size_t i = 0; i < community.size() && i < 5; ++i) {
+            board[i] = community[i].toInt();
+        }
+        int toCanonical[4];
+        unsigned long long key = canonicalSpotKey(hero, board, static_cast<int>(community.size()),
+                                                  opponentCount, toCanonical);
+        size_t count = 0;
+        const BookNode* tree = openingBook->find(key, count);
+        if (tree == NULL) {
+            return;
+        }
+        int toActual[4];
+        for (int suit = 0; suit < 4; suit++) {
+            toActual[toCanonical[suit]] = suit;
+        }
+        search.seedFromBook(tree, count, toActual);
+    }
+    
+    // Street implied by the number of known community cards
+    Street currentStreet() const {
+        if (community.size() >= 5) return STREET_RIVER;
+        if (community.size() == 4) return STREET_TURN;
+        if (community.size() >= 3) return STREET_FLOP;
+        return STREET_PREFLOP;
+    }
+    
+    // Run a single MCTS simulation
+    bool runSingleSimulation(HandRank* botRank = NULL, HandRank* opponentRank = NULL) {
+        // Initialize game with known cards
+        game.initialize(myCards, community);
+        
+        // Complete the deal
+        game.completeBoard();
+        
+        // Determine winner
+        return game.isWinner(botRank, opponentRank);
+    }
+    
+    // Cache the card sets used by runShowdownSimulation
+    void prepareShowdowns() {
+        showdownHero[0] = myCards[0].toInt();
+        showdownHero[1] = myCards[1].toInt();
+        showdownBoard.clear();
+        for (size_t i = 0; i < community.size(); ++i) {
+            showdownBoard.push_back(community[i].toInt());
+        }
+        showdownLive.clear();
+        showdownLive.reserve(DECK_SIZE);
+        for (int card = 0; card < DECK_SIZE; card++) {
+            if (card != showdownHero[0] && card != showdownHero[1] &&
+                std::find(showdownBoard.begin(), showdownBoard.end(), card) == showdownBoard.end()) {
+                showdownLive.push_back(card);
+            }
+        }
+    }
+    
+    // Run one showdown against every opponent; true if the bot wins outright
+    bool runShowdownSimulation(HandRank* botRank = NULL, HandRank* opponentRank = NULL) {
+        return simulateMultiwayShowdown(showdownHero, showdownBoard, showdownLive, opponentCount,
+                                        threadRandom(), botRank, opponentRank) == 1.0;
+    }
+    
+    // Get current win probability estimate (from the table for multiway preflop spots)
+    double getWinProbability() const {
+        if (answeredFromTable) {
+            return tableWinProbability;
+        }
+        if (searchMode == SEARCH_ISMCTS && totalRuns > 0) {
+            return search.stayValue();
+        }
+        return rootNode.getWinProbability();
+    }
+    
+    // Decide whether to fold or stay
+    bool shouldStay() const {
+        double winProbability = getWinProbability();
+        return winProbability >= WIN_PROBABILITY_THRESHOLD;
+    }
+    
+    // Print statistics
+    void printStats() const {
+        TraceSpan span("response");
+        std::cout << "Simulations run: " << totalRuns << std::endl;
+        if (searchMode == SEARCH_ISMCTS && !answeredFromTable) {
+            // The estimate is a value under later folds, not a share of outright wins
+            double low;
+            double high;
+            search.stayInterval(low, high);
+            std::cout << "Win probability: " << std::fixed << std::setprecision(2) << (getWinProbability() * 100.0)
+                      << "% (95% CI " << (low * 100.0) << "-" << (high * 100.0) << "%)" << std::endl;
+        } else {
+            std::cout << "Wins: " << winningRuns << std::endl;
+            std::cout << "Win probability: " << std::fixed << std::setprecision(2) 
+                      << (getWinProbability() * 100.0) << "%" << std::endl;
+        }
+        std::cout << "Decision: " << (shouldStay() ? "STAY" : "FOLD") << std::endl;
+        if (searchMode == SEARCH_ISMCTS) {
+            std::cout << "Tree nodes: " << search.nodeCount() << " (" << search.getPrunedNodes()
+                      << " pruned, " << search.getBookNodes() << " from the opening book)" << std::endl;
+        }
+        
+        if (totalRuns > 0) {
+            printBreakdown("Outcomes by bot's final hand:", breakdown.byBotRank);
+            printBreakdown("Outcomes by opponent's final hand:", breakdown.byOpponentRank);
+        }
+    }
+    
+    // Share of runs and bot win rate for each category that occurred
+    void printBreakdown(const std::string& title, const long long counts[10][2]) const {
+        // Share of showdowns: ISMCTS iterations that end in a fold are not recorded
+        long long showdowns = 0;
+        for (int r = 0; r < 10; r++) {
+            showdowns += counts[r][0] + counts[r][1];
+        }
+        std::cout << title << std::endl;
+        for (int r = 0; r < 10; r++) {
+            long long runs = counts[r][0] + counts[r][1];
+            if (runs == 0) continue;
+            std::cout << "  " << std::left << std::setw(16) << HandEvaluator::handRankToString(static_cast<HandRank>(r))
+                      << std::right << std::setw(6) << (runs * 100.0 / showdowns) << "% of runs, bot won "
+                      << std::setw(6) << (counts[r][1] * 100.0 / runs) << "%" << std::endl;
+        }
+    }
+    
+    // Outcomes of the last runMCTS call by final hand category
+    const OutcomeBreakdown& getOutcomeBreakdown() const {
+        return breakdown;
+    }
+};
+
+// For testing purposes
+void testHandEvaluator() {
+    std::cout << "Testing Hand Evaluator..." << std::endl;
+    
+    // Create test hands
+    Deck deck;
+    
+    // Royal Flush
+    std::vector<Card> royalFlush;
+    royalFlush.push_back(Card(HEARTS, ACE));
+    royalFlush.push_back(Card(HEARTS, KING));
+    royalFlush.push_back(Card(HEARTS, QUEEN));
+    royalFlush.push_back(Card(HEARTS, JACK));
+    royalFlush.push_back(Card(HEARTS, TEN));
+    royalFlush.push_back(Card(CLUBS, TWO));
+    royalFlush.push_back(Card(DIAMONDS, THREE));
+    
+    // Straight Flush
+    std::vector<Card> straightFlush;
+    straightFlush.push_back(Card(SPADES, NINE));
+    straightFlush.push_back(Card(SPADES, EIGHT));
+    straightFlush.push_back(Card(SPADES, SEVEN));
+    straightFlush.push_back(Card(SPADES, SIX));
+    straightFlush.push_back(Card(SPADES, FIVE));
+    straightFlush.push_back(Card(CLUBS, TWO));
+    straightFlush.push_back(Card(DIAMONDS, THREE));
+    
+    // Four of a Kind
+    std::vector<Card> fourOfAKind;
+    fourOfAKind.push_back(Card(HEARTS, ACE));
+    fourOfAKind.push_back(Card(DIAMONDS, ACE));
+    fourOfAKind.push_back(Card(CLUBS, ACE));
+    fourOfAKind.push_back(Card(SPADES, ACE));
+    fourOfAKind.push_back(Card(HEARTS, KING));
+    fourOfAKind.push_back(Card(CLUBS, TWO));
+    fourOfAKind.push_back(Card(DIAMONDS, THREE));
+    
+    // Test each hand
+    HandEvaluation eval1 = HandEvaluator::evaluate(royalFlush);
+    HandEvaluation eval2 = HandEvaluator::evaluate(straightFlush);
+    HandEvaluation eval3 = HandEvaluator::evaluate(fourOfAKind);
+    
+    // Print results
+    std::cout << "Royal Flush: " << HandEvaluator::handRankToString(eval1.rank) << std::endl;
+    std::cout << "Straight Flush: " << HandEvaluator::handRankToString(eval2.rank) << std::endl;
+    std::cout << "Four of a Kind: " << HandEvaluator::handRankToString(eval3.rank) << std::endl;
+    
+    // Test comparison
+    std::cout << "Royal Flush > Straight Flush: " << (eval1 > eval2 ? "Yes" : "No") << std::endl;
+    std::cout << "Straight Flush > Four of a Kind: " << (eval2 > eval3 ? "Yes" : "No") << std::endl;
+    
+    std::cout << "Hand Evaluator Tests Complete" << std::endl;
+}
+
+// Number of 7-card hands per category (Royal Flush listed separately from Straight Flush)
+const long long SEVEN_CARD_CENSUS[10] = {
+    23294460, 58627800, 31433400, 6461620, 6180020,
+    4047644, 3473184, 224848, 37260, 4324
+};
+
+// Enumerate all C(52,7) hands across every core. Checks the reference evaluator's category
+// census and that the fast evaluator agrees with it on every hand. Returns true on success.
+bool validateEvaluator() {
+    int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "Validating evaluator on all 133784560 seven-card hands with "
+              << threadCount << " threads..." << std::endl;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    
+    // Work units are the first two cards; later units are claimed dynamically
+    std::vector<std::pair<int, int> > units;
+    for (int c0 = 0; c0 < DECK_SIZE; c0++) {
+        for (int c1 = c0 + 1; c1 < DECK_SIZE; c1++) {
+            units.push_back(std::make_pair(c0, c1));
+        }
+    }
+    std::atomic<size_t> nextUnit(0);
+    
+    std::mutex resultMutex;
+    long long census[10] = {0};
+    long long mismatches = 0;
+    size_t firstMismatchUnit = units.size();
+    int firstMismatch[7] = {0};
+    
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threadCount; t++) {
+        workers.push_back(std::thread([&]() {
+            long long localCensus[10] = {0};
+            long long localMismatches = 0;
+            size_t localFirstUnit = units.size();
+            int localFirst[7] = {0};
+            std::vector<Card> hand(7, Card(CLUBS, TWO));
+            int cards[7];
+            int masks[6][4];
+            
+            for (size_t u = nextUnit++; u < units.size(); u = nextUnit++) {
+                cards[0] = units[u].first;
+                cards[1] = units[u].second;
+                for (int s = 0; s < 4; s++) masks[1][s] = 0;
+                masks[1][cards[0] / 13] |= 1 << (cards[0] % 13);
+                masks[1][cards[1] / 13] |= 1 << (cards[1] % 13);
+                
+                // Add one card per level so each leaf only ORs in the last card
+                for (cards[2] = cards[1] + 1; cards[2] < DECK_SIZE; cards[2]++) {
+                    std::copy(masks[1], masks[1] + 4, masks[2]);
+                    masks[2][cards[2] / 13] |= 1 << (cards[2] % 13);
+                    for (cards[3] = cards[2] + 1; cards[3] < DECK_SIZE; cards[3]++) {
+                        std::copy(masks[2], masks[2] + 4, masks[3]);
+                        masks[3][cards[3] / 13] |= 1 << (cards[3] % 13);
+                        for (cards[4] = cards[3] + 1; cards[4] < DECK_SIZE; cards[4]++) {
+                            std::copy(masks[3], masks[3] + 4, masks[4]);
+                            masks[4][cards[4] / 13] |= 1 << (cards[4] % 13);
+                            for (cards[5] = cards[4] + 1; cards[5] < DECK_SIZE; cards[5]++) {
+                                std::copy(masks[4], masks[4] + 4, masks[5]);
+                                masks[5][cards[5] / 13] |= 1 << (cards[5] % 13);
+                                for (cards[6] = cards[5] + 1; cards[6] < DECK_SIZE; cards[6]++) {
+                                    int leaf[4];
+                                    std::copy(masks[5], masks[5] + 4, leaf);
+                                    leaf[cards[6] / 13] |= 1 << (cards[6] % 13);
+                                    int fast = HandEvaluator::evaluateMasks(leaf);
+                                    
+                                    for (int i = 0; i < 7; i++) hand[i] = Card::fromInt(cards[i]);
+                                    HandEvaluation reference = HandEvaluator::evaluateComplete(hand);
+                                    localCensus[reference.rank]++;
+                                    
+                                    if (fast != HandEvaluator::packEvaluation(reference)) {
+                                        if (localMismatches++ == 0) {
+                                            localFirstUnit = u;
+                                            std::copy(cards, cards + 7, localFirst);
+                                        }
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            
+            std::lock_guard<std::mutex> lock(resultMutex);
+            for (int r = 0; r < 10; r++) census[r] += localCensus[r];
+            mismatches += localMismatches;
+            if (localFirstUnit < firstMismatchUnit) {
+                firstMismatchUnit = localFirstUnit;
+                std::copy(localFirst, localFirst + 7, firstMismatch);
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+    
+    bool ok = true;
+    for (int r = 0; r < 10; r++) {
+        bool match = census[r] == SEVEN_CARD_CENSUS[r];
+        ok = ok && match;
+        std::cout << std::setw(16) << HandEvaluator::handRankToString(static_cast<HandRank>(r)) << ": "
+                  << census[r] << (match ? "" : " (expected " + std::to_string(SEVEN_CARD_CENSUS[r]) + ")")
+                  << std::endl;
+    }
+    
+    if (mismatches > 0) {
+        ok = false;
+        std::vector<Card> hand;
+        for (int i = 0; i < 7; i++) hand.push_back(Card::fromInt(firstMismatch[i]));
+        std::cout << "Fast evaluator mismatches: " << mismatches << ", first on " << cardsToString(hand)
+                  << std::hex << " (reference " << HandEvaluator::packEvaluation(HandEvaluator::evaluateComplete(hand))
+                  << ", fast " << HandEvaluator::evaluateFast(hand) << ")" << std::dec << std::endl;
+    }
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Validation " << (ok ? "passed" : "FAILED") << " in " << std::fixed
+              << std::setprecision(1) << seconds << " s" << std::endl;
+    return ok;
+}
+
+// Parse a card from `length` characters at `text` (e.g., "AS" for Ace of Spades)
+Card parseCard(const char* text, size_t length) {
+    if (length < 2) {
+        throw std::runtime_error("Invalid card format");
+    }
+    
+    // Parse value
+    Value value;
+    if (text[0] == 'A') value = ACE;
+    else if (text[0] == 'K') value = KING;
+    else if (text[0] == 'Q') value = QUEEN;
+    else if (text[0] == 'J') value = JACK;
+    else if (text[0] == 'T' || text[0] == '1') value = TEN;
+    else if (text[0] >= '2' && text[0] <= '9') {
+        value = static_cast<Value>(text[0] - '0');
+    } else {
+        throw std::runtime_error("Invalid card value");
+    }
+    
+    // Parse suit
+    Suit suit;
+    char suitChar = text[length - 1];
+    if (suitChar == 'C' || suitChar == 'c') suit = CLUBS;
+    else if (suitChar == 'D' || suitChar == 'd') suit = DIAMONDS;
+    else if (suitChar == 'H' || suitChar == 'h') suit = HEARTS;
+    else if (suitChar == 'S' || suitChar == 's') suit = SPADES;
+    else {
+        throw std::runtime_error("Invalid card suit");
+    }
+    
+    return Card(suit, value);
+}
+
+// Parse a card string (e.g., "AS" for Ace of Spades)
+Card parseCard(const std::string& cardStr) {
+    return parseCard(cardStr.data(), cardStr.size());
+}
+
+// A submitter attached to a shared computation
+struct QueryWaiter {
+    int id;
+    long long targetSimulations;
+    std::chrono::steady_clock::time_point submitted;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+// Resumable state of one query: a PokerBot decision that runs a chunk of simulations per
+// step through PokerBot::simulate and then yields, so a pending query costs a bot (a few KB,
+// no strength tables) rather than a thread and a stack. Identical concurrent queries share
+// one task, each waiting for its own target and deadline. The task and its bot live in the
+// task's own QueryArena.
+struct QueryTask {
+    QueryArena* arena;
+    unsigned long long key;
+    PokerBot* bot;
+    std::vector<QueryWaiter, ArenaAllocator<QueryWaiter> > waiters;
+    std::chrono::steady_clock::time_point deadline;   // earliest waiter deadline
+    double cpuMs;                                     // thread CPU spent opening and stepping the bot
+
+    explicit QueryTask(QueryArena* owner) : arena(owner), key(0), bot(NULL),
+                                            waiters(ArenaAllocator<QueryWaiter>(owner)), cpuMs(0.0) {}
+
+    // A task whose bot has opened the decision for `query`
+    static QueryTask* create(const EquityQuery& query) {
+        QueryArena* arena = QueryArena::acquire();
+        QueryTask* task = new (arena->allocate(sizeof(QueryTask), alignof(QueryTask))) QueryTask(arena);
+        task->bot = new (arena->allocate(sizeof(PokerBot), alignof(PokerBot))) PokerBot();
+        task->bot->setStrengthTables(false);
+        task->bot->setKnownCards(query.holeCards, query.communityCards);
+        task->bot->setOpponentCount(query.opponents);
+        double cpuStart = threadCpuMs();
+        task->bot->beginDecision();
+        task->cpuMs = threadCpuMs() - cpuStart;
+        return task;
+    }
+
+    static void destroy(QueryTask* task) {
+        QueryArena* arena = task->arena;
+        task->bot->~PokerBot();
+        task->~QueryTask();
+        QueryArena::recycle(arena);
+    }
+};
+
+// Earliest deadline first: the heap functions keep the largest on top, so invert
+struct LaterDeadline {
+    bool operator()(const QueryTask* a, const QueryTask* b) const {
+        return a->deadline > b->deadline;
+    }
+};
+
+// Cooperative scheduler that interleaves many PokerBot queries on the thread that calls
+// run(). Run one executor per core to use a whole machine. Tasks live in per-query arenas
+// and the scheduler's own containers in the executor's arena, so steady-state scheduling
+// never reaches the global allocator.
+class QueryExecutor {
+private:
+    typedef std::map<unsigned long long, QueryTask*, std::less<unsigned long long>,
+                     RecyclingAllocator<std::pair<const unsigned long long, QueryTask*> > > TaskMap;
+
+    RecyclingArena storage;
+    std::vector<QueryTask*, RecyclingAllocator<QueryTask*> > ready;   // heap ordered by LaterDeadline
+    TaskMap inFlight;                                                 // coalescing by canonical key
+    AsyncLineWriter* recordWriter;                                    // NULL: no decision records
+
+    // Run one chunk of the largest outstanding target
+    void step(QueryTask& task) {
+        TraceSpan span("query chunk");
+        span.setArg(static_cast<long long>(task.waiters.size()));
+        long long target = 0;
+        for (size_t i = 0; i < task.waiters.size(); ++i) {
+            target = std::max(target, task.waiters[i].targetSimulations);
+        }
+        long long chunk = std::min<long long>(QUERY_CHUNK_SIMULATIONS, target - task.bot->getSimulationCount());
+        double cpuStart = threadCpuMs();
+        task.bot->simulate(chunk);
+        task.cpuMs += threadCpuMs() - cpuStart;
+        Metrics::add(METRIC_SIMULATIONS, chunk);
+    }
+
+    // Report every waiter whose target is met or whose deadline has passed. Each one is a
+    // decision for the metrics and the record writer, timed from its submission and checked
+    // against its own deadline.
+    template <typename Callback>
+    void resolveWaiters(QueryTask& task, Callback& onResult) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        long long runs = task.bot->getSimulationCount();
+        int boardSize = static_cast<int>(task.bot->getCommunityCards().size());
+        Street street = boardSize == 0 ? STREET_PREFLOP : static_cast<Street>(boardSize - 2);
+        size_t kept = 0;
+        for (size_t i = 0; i < task.waiters.size(); ++i) {
+            const QueryWaiter waiter = task.waiters[i];
+            bool reached = runs >= waiter.targetSimulations;
+            bool missed = !reached && now >= waiter.deadline;
+            if (!reached && !missed) {
+                task.waiters[kept++] = waiter;
+                continue;
+            }
+            if (missed) Metrics::add(METRIC_DEADLINE_MISSES);
+            Metrics::addQueueDepth(-1);
+            double wallMs = std::chrono::duration<double, std::milli>(now - waiter.submitted).count();
+            Metrics::add(METRIC_DECISIONS);
+            Metrics::observeLatency(street, wallMs);
+            if (recordWriter != NULL) {
+                DecisionRecord record = task.bot->decisionSummary();
+                record.cpuMs = task.cpuMs;
+                record.wallMs = wallMs;
+                record.deadlineSlackMs = std::chrono::duration<double, std::milli>(waiter.deadline - now).count();
+                recordWriter->write(record.toJson());
+            }
+            EquityResult result;
+            result.id = waiter.id;
+            result.simulations = runs;
+            result.winProbability = task.bot->getWinProbability();
+            result.deadlineMissed = missed;
+            onResult(result);
+        }
+        task.waiters.resize(kept);
+        updateDeadline(task);
+    }
+
+    static void updateDeadline(QueryTask& task) {
+        for (size_t i = 0; i < task.waiters.size(); ++i) {
+            if (i == 0 || task.waiters[i].deadline < task.deadline) {
+                task.deadline = task.waiters[i].deadline;
+            }
+        }
+    }
+
+public:
+    QueryExecutor() : ready(RecyclingAllocator<QueryTask*>(&storage)),
+                      inFlight(std::less<unsigned long long>(), TaskMap::allocator_type(&storage)), recordWriter(NULL) {}
+
+    ~QueryExecutor() {
+        for (size_t i = 0; i < ready.size(); ++i) {
+            Metrics::addQueueDepth(-static_cast<long long>(ready[i]->waiters.size()));
+            QueryTask::destroy(ready[i]);
+        }
+    }
+
+    // Write a DecisionRecord line for every answered query (NULL disables)
+    void setRecordWriter(AsyncLineWriter* writer) {
+        recordWriter = writer;
+    }
+    
+    // Coalescing key of a query
+    static unsigned long long spotKey(const EquityQuery& query) {
+        if (query.holeCards.size() != 2 || query.communityCards.size() > 5) {
+            throw std::runtime_error("A query needs two hole cards and at most five community cards");
+        }
+        int hero[2] = { query.holeCards[0].toInt(), query.holeCards[1].toInt() };
+        int boardCards[5] = {0, 0, 0, 0, 0};
+        int boardSize = static_cast<int>(query.communityCards.size());
+        for (int i = 0; i < boardSize; i++) {
+            boardCards[i] = query.communityCards[i].toInt();
+        }
+        return canonicalSpotKey(hero, boardCards, boardSize, std::max(1, std::min(query.opponents, MAX_OPPONENTS)));
+    }
+
+    void submit(const EquityQuery& query) {
+        unsigned long long key = spotKey(query);
+        
+        QueryWaiter waiter;
+        waiter.id = query.id;
+        waiter.targetSimulations = query.targetSimulations;
+        waiter.submitted = std::chrono::steady_clock::now();
+        waiter.deadline = waiter.submitted + std::chrono::milliseconds(query.deadlineMs);
+        Metrics::addQueueDepth(1);
+        
+        TaskMap::iterator existing = inFlight.find(key);
+        if (existing != inFlight.end()) {
+            QueryTask* task = existing->second;
+            task->waiters.push_back(waiter);
+            Metrics::add(METRIC_COALESCED_QUERIES);
+            if (waiter.deadline < task->deadline) {
+                task->deadline = waiter.deadline;
+                std::make_heap(ready.begin(), ready.end(), LaterDeadline());
+            }
+            return;
+        }
+        
+        QueryTask* task = QueryTask::create(query);
+        task->key = key;
+        task->waiters.push_back(waiter);
+        task->deadline = waiter.deadline;
+        inFlight[key] = task;
+        ready.push_back(task);
+        std::push_heap(ready.begin(), ready.end(), LaterDeadline());
+    }
+
+    // Computations still running (coalesced queries count once)
+    size_t pending() const {
+        return ready.size();
+    }
+
+    // Step the computation with the earliest outstanding deadline by one chunk, reporting
+    // each query that completes; false when nothing is pending
+    template <typename Callback>
+    bool runOnce(Callback& onResult) {
+        if (ready.empty()) return false;
+        std::pop_heap(ready.begin(), ready.end(), LaterDeadline());
+        QueryTask* task = ready.back();
+        ready.pop_back();
+        
+        resolveWaiters(*task, onResult);
+        if (!task->waiters.empty()) {
+            step(*task);
+            resolveWaiters(*task, onResult);
+        }
+        
+        if (task->waiters.empty()) {
+            inFlight.erase(task->key);
+            QueryTask::destroy(task);
+        } else {
+            ready.push_back(task);
+            std::push_heap(ready.begin(), ready.end(), LaterDeadline());
+        }
+        return true;
+    }
+
+    // Step chunks until every query has met its target or deadline
+    template <typename Callback>
+    void run(Callback onResult) {
+        while (runOnce(onResult)) {
+        }
+    }
+};
+
+// Parse one batch line in place: cards (hole cards first, then the board) followed by
+// optional n=<simulations>, ms=<deadline>, opp=<opponents>
+EquityQuery parseBatchQuery(const char* begin, const char* end, int id) {
+    EquityQuery query;
+    query.id = id;
+    query.targetSimulations = BATCH_DEFAULT_SIMULATIONS;
+    query.deadlineMs = BATCH_DEFAULT_DEADLINE_MS;
+    std::vector<Card> cards;
+    const char* p = begin;
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+        const char* token = p;
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r') p++;
+        size_t length = static_cast<size_t>(p - token);
+        if (length == 0) break;
+        
+        const char* equals = static_cast<const char*>(std::memchr(token, '=', length));
+        if (equals == NULL) {
+            cards.push_back(parseCard(token, length));
+            continue;
+        }
+        long long value = std::strtoll(std::string(equals + 1, p).c_str(), NULL, 10);
+        std::string key(token, equals);
+        if (key == "n") query.targetSimulations = std::max(1LL, value);
+        else if (key == "ms") query.deadlineMs = static_cast<int>(std::max(0LL, value));
+        else if (key == "opp") query.opponents = static_cast<int>(value);
+        else throw std::runtime_error("Unknown option " + key);
+    }
+    if (cards.size() < 2 || cards.size() == 3 || cards.size() > 7) {
+        throw std::runtime_error("Expected two hole cards and 0, 3, 4 or 5 community cards");
+    }
+    long long seen = 0;
+    for (size_t i = 0; i < cards.size(); ++i) {
+        long long bit = 1LL << cards[i].toInt();
+        if (seen & bit) {
+            throw std::runtime_error("Card " + cards[i].toString() + " appears twice");
+        }
+        seen |= bit;
+    }
+    query.holeCards.assign(cards.begin(), cards.begin() + 2);
+    query.communityCards.assign(cards.begin() + 2, cards.end());
+    return query;
+}
+
+// Batch mode: the whole input is mapped (or read once from stdin) and parsed in place,
+// queries are spread over one QueryExecutor per core by spot, and results are appended to
+// per-thread buffers. Full buffers are handed to the calling thread, the only writer, which
+// sends them through io_uring when available so the workers never wait on output. Output
+// lines are "<line> <win probability> <simulations>" with " MISS" when the deadline cut a
+// query short. With a record writer, every answered query also writes a DecisionRecord.
+bool runBatch(const std::string& inputPath, const std::string& outputPath, AsyncLineWriter* recordWriter) {
+    MappedFile mapped;
+    std::vector<char> stdinBuffer;
+    const char* data;
+    size_t size;
+    if (inputPath == "-") {
+        char chunk[1 << 16];
+        size_t count;
+        while ((count = std::fread(chunk, 1, sizeof(chunk), stdin)) > 0) {
+            stdinBuffer.insert(stdinBuffer.end(), chunk, chunk + count);
+        }
+        data = stdinBuffer.empty() ? "" : &stdinBuffer[0];
+        size = stdinBuffer.size();
+    } else {
+        if (!mapped.open(inputPath)) return false;
+        data = mapped.data();
+        size = mapped.size();
+    }
+    
+    FILE* out = outputPath == "-" ? stdout : std::fopen(outputPath.c_str(), "wb");
+    if (out == NULL) return false;
+    
+    // Split into lines without copying
+    std::vector<std::pair<const char*, const char*> > lines;
+    for (const char* p = data; p < data + size; ) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', data + size - p));
+        const char* lineEnd = newline != NULL ? newline : data + size;
+        lines.push_back(std::make_pair(p, lineEnd));
+        p = lineEnd + 1;
+    }
+    
+    // Route identical spots to the same executor so they coalesce
+    int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::vector<EquityQuery> > assigned(threadCount);
+    std::string errors;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (lines[i].first == lines[i].second || *lines[i].first == '#') continue;
+        try {
+            EquityQuery query = parseBatchQuery(lines[i].first, lines[i].second, static_cast<int>(i) + 1);
+            assigned[QueryExecutor::spotKey(query) % threadCount].push_back(query);
+        } catch (const std::runtime_error& e) {
+            errors += std::to_string(i + 1) + " ERROR " + e.what() + "\n";
+        }
+    }
+    
+#ifdef POKERBOT_HAS_IO_URING
+    std::fflush(out);
+    UringWriter uringWriter;
+    bool useUring = uringWriter.open(fileno(out), BATCH_OUTPUT_FLUSH_BYTES);
+#else
+    bool useUring = false;
+#endif
+    std::function<void(const std::string&)> writeOutput = [&](const std::string& chunk) {
+#ifdef POKERBOT_HAS_IO_URING
+        if (useUring) {
+            uringWriter.append(chunk.data(), chunk.size());
+            return;
+        }
+#endif
+        std::fwrite(chunk.data(), 1, chunk.size(), out);
+    };
+    writeOutput(errors);
+    
+    std::mutex outputMutex;
+    std::condition_variable outputReady;
+    std::deque<std::string> outputQueue;
+    int running = threadCount;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threadCount; t++) {
+        workers.push_back(std::thread([&, t]() {
+            std::string buffer;
+            QueryExecutor executor;
+            executor.setRecordWriter(recordWriter);
+            for (size_t i = 0; i < assigned[t].size(); ++i) {
+                executor.submit(assigned[t][i]);
+            }
+            
+            executor.run([&](const EquityResult& result) {
+                char line[96];
+                int length = std::snprintf(line, sizeof(line), "%d %.6f %lld%s\n", result.id, result.winProbability,
+                                           result.simulations, result.deadlineMissed ? " MISS" : "");
+                buffer.append(line, static_cast<size_t>(length));
+                if (buffer.size() >= BATCH_OUTPUT_FLUSH_BYTES) {
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    outputQueue.push_back(std::string());
+                    outputQueue.back().swap(buffer);
+                    outputReady.notify_one();
+                }
+            });
+            std::lock_guard<std::mutex> lock(outputMutex);
+            outputQueue.push_back(std::string());
+            outputQueue.back().swap(buffer);
+            running--;
+            outputReady.notify_one();
+        }));
+    }
+    
+    std::unique_lock<std::mutex> lock(outputMutex);
+    while (true) {
+        outputReady.wait(lock, [&]() { return !outputQueue.empty() || running == 0; });
+        if (outputQueue.empty()) break;
+        std::string chunk;
+        chunk.swap(outputQueue.front());
+        outputQueue.pop_front();
+        lock.unlock();
+        writeOutput(chunk);
+        lock.lock();
+    }
+    lock.unlock();
+    for (size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+    
+#ifdef POKERBOT_HAS_IO_URING
+    bool ok = !useUring || uringWriter.finish();
+#else
+    bool ok = true;
+#endif
+    ok = std::fflush(out) == 0 && ok;
+    if (out != stdout) ok = std::fclose(out) == 0 && ok;
+    return ok;
+}
+
+#ifdef POKERBOT_HAS_IO_URING
+// One client of the query server. Lines are parsed in place from the connection's registered
+// input buffer and results are written from its registered output buffer.
+struct ServerConnection {
+    int fd;                     // -1 when the slot is free
+    unsigned generation;        // bumped on reuse, so completions and results for an old client are dropped
+    size_t inputUsed;
+    size_t outputUsed;
+    size_t outputWritten;       // bytes of the in-flight write already sent
+    bool writing;
+    int lineNumber;
+    std::string backlog;        // results that arrived while the output buffer was being written
+
+    ServerConnection() : fd(-1), generation(0), inputUsed(0), outputUsed(0), outputWritten(0),
+                         writing(false), lineNumber(0) {}
+};
+
+// Where a query's result goes
+struct ServerReply {
+    int slot;
+    unsigned generation;
+    int lineNumber;
+};
+
+enum ServerOperation {
+    SERVER_ACCEPT,
+    SERVER_READ,
+    SERVER_WRITE
+};
+
+volatile std::sig_atomic_t serverStopRequested = 0;
+
+void requestServerStop(int) {
+    serverStopRequested = 1;
+}
+
+// Query server on a Unix socket, driven by one io_uring event loop on the calling thread:
+// accepts, reads and writes are completions on the ring, and the loop steps one
+// QueryExecutor chunk between polls, so every connection and query shares one thread with
+// no blocking I/O. Each request line uses the --batch syntax and is answered with
+// "<line> <win probability> <simulations>" (" MISS" when cut short) or "<line> ERROR <why>",
+// where <line> counts that connection's lines. Runs until SIGINT or SIGTERM. With a record
+// writer, every answered query also writes a DecisionRecord.
+bool runServer(const std::string& socketPath, AsyncLineWriter* recordWriter) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: socket path too long" << std::endl;
+        return false;
+    }
+    std::strcpy(address.sun_path, socketPath.c_str());
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0) return false;
+    unlink(socketPath.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listener, SOMAXCONN) != 0) {
+        ::close(listener);
+        return false;
+    }
+    
+    IoUring ring;
+    std::vector<char> storage(2 * SERVER_MAX_CONNECTIONS * SERVER_BUFFER_BYTES);
+    std::vector<iovec> registered(2 * SERVER_MAX_CONNECTIONS);
+    for (size_t i = 0; i < registered.size(); ++i) {
+        registered[i].iov_base = &storage[i * SERVER_BUFFER_BYTES];
+        registered[i].iov_len = SERVER_BUFFER_BYTES;
+    }
+    if (!ring.open(2 * SERVER_MAX_CONNECTIONS + 2) ||
+        !ring.registerBuffers(&registered[0], static_cast<unsigned>(registered.size()))) {
+        std::cerr << "Error: io_uring is not available" << std::endl;
+        ::close(listener);
+        unlink(socketPath.c_str());
+        return false;
+    }
+    
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = requestServerStop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    
+    std::vector<ServerConnection> connections(SERVER_MAX_CONNECTIONS);
+    std::unordered_map<int, ServerReply> replies;
+    int nextQueryId = 0;
+    QueryExecutor executor;
+    executor.setRecordWriter(recordWriter);
+    
+    // user_data: operation in bits 0-7, slot in bits 8-23, generation above
+    auto tag = [&](ServerOperation operation, int slot) {
+        return static_cast<unsigned long long>(operation) | (static_cast<unsigned long long>(slot) << 8) |
+               (static_cast<unsigned long long>(connections[slot].generation) << 24);
+    };
+    auto inputBuffer = [&](int slot) { return &storage[2 * slot * SERVER_BUFFER_BYTES]; };
+    auto outputBuffer = [&](int slot) { return &storage[(2 * slot + 1) * SERVER_BUFFER_BYTES]; };
+    auto submitAccept = [&]() {
+        ring.prepare(IORING_OP_ACCEPT, listener, SERVER_ACCEPT);
+    };
+    auto submitRead = [&](int slot) {
+        ServerConnection& connection = connections[slot];
+        ring.prepareFixed(IORING_OP_READ_FIXED, connection.fd, 2 * slot, inputBuffer(slot) + connection.inputUsed,
+                          SERVER_BUFFER_BYTES - connection.inputUsed, 0, tag(SERVER_READ, slot));
+    };
+    auto submitWrite = [&](int slot) {
+        ServerConnection& connection = connections[slot];
+        connection.writing = true;
+        ring.prepareFixed(IORING_OP_WRITE_FIXED, connection.fd, 2 * slot + 1,
+                          outputBuffer(slot) + connection.outputWritten,
+                          connection.outputUsed - connection.outputWritten, 0, tag(SERVER_WRITE, slot));
+    };
+    auto closeConnection = [&](int slot) {
+        ServerConnection& connection = connections[slot];
+        ::close(connection.fd);
+        unsigned generation = connection.generation + 1;
+        connection = ServerConnection();
+        connection.generation = generation;
+    };
+    // Queue a result line; buffered output is written once per loop iteration
+    auto reply = [&](int slot, const char* text, size_t length) {
+        ServerConnection& connection = connections[slot];
+        if (connection.writing || !connection.backlog.empty() ||
+            connection.outputUsed + length > SERVER_BUFFER_BYTES) {
+            connection.backlog.append(text, length);
+            return;
+        }
+        std::memcpy(outputBuffer(slot) + connection.outputUsed, text, length);
+        connection.outputUsed += length;
+    };
+    auto onResult = [&](const EquityResult& result) {
+        std::unordered_map<int, ServerReply>::iterator found = replies.find(result.id);
+        if (found == replies.end()) return;
+        ServerReply target = found->second;
+        replies.erase(found);
+        if (connections[target.slot].fd < 0 || connections[target.slot].generation != target.generation) return;
+        char line[96];
+        int length = std::snprintf(line, sizeof(line), "%d %.6f %lld%s\n", target.lineNumber, result.winProbability,
+                                   result.simulations, result.deadlineMissed ? " MISS" : "");
+        reply(target.slot, line, static_cast<size_t>(length));
+    };
+    // Submit every complete line in the input buffer and keep the partial tail
+    auto parseLines = [&](int slot) {
+        ServerConnection& connection = connections[slot];
+        char* data = inputBuffer(slot);
+        size_t start = 0;
+        while (true) {
+            char* newline = static_cast<char*>(std::memchr(data + start, '\n', connection.inputUsed - start));
+            if (newline == NULL) break;
+            const char* begin = data + start;
+            start = static_cast<size_t>(newline - data) + 1;
+            int lineNumber = ++connection.lineNumber;
+            if (begin == newline || *begin == '#' || *begin == '\r') continue;
+            try {
+                EquityQuery query = parseBatchQuery(begin, newline, nextQueryId);
+                ServerReply target = { slot, connection.generation, lineNumber };
+                replies[nextQueryId++] = target;
+                executor.submit(query);
+            } catch (const std::runtime_error& e) {
+                std::string error = std::to_string(lineNumber) + " ERROR " + e.what() + "\n";
+                reply(slot, error.data(), error.size());
+            }
+        }
+        if (start == 0 && connection.inputUsed == SERVER_BUFFER_BYTES) {
+            std::string error = std::to_string(++connection.lineNumber) + " ERROR Line too long\n";
+            reply(slot, error.data(), error.size());
+            connection.inputUsed = 0;
+            return;
+        }
+        std::memmove(data, data + start, connection.inputUsed - start);
+        connection.inputUsed -= start;
+    };
+    auto onCompletion = [&](unsigned long long userData, int result) {
+        ServerOperation operation = static_cast<ServerOperation>(userData & 0xFF);
+        int slot = static_cast<int>((userData >> 8) & 0xFFFF);
+        unsigned generation = static_cast<unsigned>(userData >> 24);
+        if (operation == SERVER_ACCEPT) {
+            if (result >= 0) {
+                int free = -1;
+                for (int c = 0; c < SERVER_MAX_CONNECTIONS && free < 0; c++) {
+                    if (connections[c].fd < 0) free = c;
+                }
+                if (free < 0) {
+                    ::close(result);
+                } else {
+                    connections[free].fd = result;
+                    submitRead(free);
+                }
+            }
+            submitAccept();
+            return;
+        }
+        ServerConnection& connection = connections[slot];
+        if (connection.fd < 0 || connection.generation != generation) return;
+        if (result <= 0) {
+            closeConnection(slot);
+            return;
+        }
+        if (operation == SERVER_READ) {
+            connection.inputUsed += static_cast<size_t>(result);
+            parseLines(slot);
+            submitRead(slot);
+            return;
+        }
+        connection.outputWritten += static_cast<size_t>(result);
+        if (connection.outputWritten < connection.outputUsed) {
+            submitWrite(slot);
+            return;
+        }
+        connection.writing = false;
+        connection.outputUsed = connection.outputWritten = 0;
+        size_t moved = std::min(connection.backlog.size(), SERVER_BUFFER_BYTES);
+        std::memcpy(outputBuffer(slot), connection.backlog.data(), moved);
+        connection.backlog.erase(0, moved);
+        connection.outputUsed = moved;
+    };
+    
+    submitAccept();
+    while (!serverStopRequested) {
+        ring.reap(onCompletion);
+        bool busy = executor.runOnce(onResult);
+        for (int c = 0; c < SERVER_MAX_CONNECTIONS; c++) {
+            if (connections[c].fd >= 0 && !connections[c].writing && connections[c].outputUsed > 0) {
+                submitWrite(c);
+            }
+        }
+        if (!ring.submit(busy ? 0 : 1)) break;
     }
     
-    // Get the community cards
-    const std::vector<Card>& getCommunityCards() const {
-        return community;
+    for (int c = 0; c < SERVER_MAX_CONNECTIONS; c++) {
+        if (connections[c].fd >= 0) ::close(connections[c].fd);
     }
-    
-    // Run Monte Carlo simulations for a specified time limit
-    double runMCTS(int msTimeLimit) {
-        clock_t startTime = clock();
-        totalRuns = 0;
-        winningRuns = 0;
-        
-        // Create root node
-        rootNode = MCTSNode();
-        
-        while (true) {
-            // Check time limit (approximate conversion to milliseconds)
-            clock_t currentTime = clock();
-            int elapsedMs = ((currentTime - startTime) * 1000) / CLOCKS_PER_SEC;
-                
-            if (elapsedMs >= msTimeLimit) {
-                break;
-            }
-            
-            // Run a single simulation
-            bool won = runSingleSimulation();
-            rootNode.update(won);
-            
-            totalRuns++;
-            if (won) {
-                winningRuns++;
-            }
+    ::close(listener);
+    unlink(socketPath.c_str());
+    return true;
+}
+#endif
+
+// Sample variance of a list of estimates
+double sampleVariance(const std::vector<double>& values) {
+    if (values.size() < 2) return 0.0;
+    double mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+    double sum = 0.0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        sum += (values[i] - mean) * (values[i] - mean);
+    }
+    return sum / (values.size() - 1);
+}
+
+// Score candidate holdings on one board with compareHoldings and print each one's win
+// probability and edge over the first candidate. The edge is estimated in repeated runs
+// both from shared samples and from an independent run per candidate, and the ratio of
+// the two variances shows what the common random numbers save.
+void printHoldingComparison(const std::vector<Card>& board, const std::vector<std::vector<Card> >& candidates) {
+    if (candidates.size() < 2) {
+        throw std::runtime_error("Comparing holdings needs at least two candidates");
+    }
+    PokerBot bot;
+    bot.setKnownCards(std::vector<Card>(), board);
+    size_t count = candidates.size();
+    std::vector<double> winProbability(count, 0.0);
+    std::vector<std::vector<double> > sharedEdges(count);
+    std::vector<std::vector<double> > independentEdges(count);
+    for (int r = 0; r < COMPARE_REPETITIONS; r++) {
+        std::vector<double> shared = bot.compareHoldings(candidates, COMPARE_SAMPLES);
+        std::vector<double> independent(count);
+        for (size_t c = 0; c < count; ++c) {
+            independent[c] = bot.compareHoldings(std::vector<std::vector<Card> >(1, candidates[c]), COMPARE_SAMPLES)[0];
+        }
+        for (size_t c = 0; c < count; ++c) {
+            winProbability[c] += shared[c] / COMPARE_REPETITIONS;
+            sharedEdges[c].push_back(shared[c] - shared[0]);
+            independentEdges[c].push_back(independent[c] - independent[0]);
         }
-        
-        return getWinProbability();
     }
     
-    // Run a single MCTS simulation
-    bool runSingleSimulation() {
-        // Initialize game with known cards
-        game.initialize(myCards, community);
-        
-        // Complete the deal
-        game.completeBoard();
+    std::cout << "Holdings on [" << cardsToString(board) << "] (" << COMPARE_REPETITIONS << " runs of "
+              << COMPARE_SAMPLES << " samples)" << std::endl;
+    for (size_t c = 0; c < count; ++c) {
+        std::cout << cardsToString(candidates[c]) << ": " << std::fixed << std::setprecision(2)
+                  << (winProbability[c] * 100.0) << "% win";
+        if (c > 0) {
+            double sharedVariance = sampleVariance(sharedEdges[c]);
+            double independentVariance = sampleVariance(independentEdges[c]);
+            double mean = std::accumulate(sharedEdges[c].begin(), sharedEdges[c].end(), 0.0) / COMPARE_REPETITIONS;
+            std::cout << ", edge over " << cardsToString(candidates[0]) << " " << std::showpos
+                      << (mean * 100.0) << std::noshowpos << " pts, sd shared " << std::setprecision(3)
+                      << (std::sqrt(sharedVariance) * 100.0) << " vs independent "
+                      << (std::sqrt(independentVariance) * 100.0) << " (variance x" << std::setprecision(1)
+                      << (sharedVariance > 0 ? independentVariance / sharedVariance : 0.0) << " lower)";
+        }
+        std::cout << std::endl;
+    }
+}
+
+// Build an opening book: one ISMCTS search per line of `spotsPath` (batch syntax: hole
+// cards, board cards, optional opp=<opponents> and ms=<search time>), each tree exported
+// under its canonical spot key. Spots with the same key keep the last tree. The searches
+// run under the given rollout policy (NULL: none), leaf model (NULL: rollouts) and node
+// budget, and the book records that model.
+bool buildOpeningBook(const std::string& spotsPath, const std::string& bookPath, const RolloutPolicy* policy,
+                      double potOdds, const LeafEvaluator* leaf, size_t nodeBudget) {
+    std::ifstream in(spotsPath.c_str());
+    if (!in) {
+        return false;
+    }
+    std::map<unsigned long long, std::vector<BookNode> > trees;
+    std::string line;
+    int lineNumber = 0;
+    InfoSetSearch search;
+    search.setRolloutPolicy(policy, potOdds);
+    search.setLeafEvaluator(leaf);
+    search.setNodeBudget(nodeBudget);
+    while (std::getline(in, line)) {
+        lineNumber++;
+        if (line.find_first_not_of(" \t\r") == std::string::npos || line[0] == '#') continue;
+        EquityQuery query;
+        try {
+            query = parseBatchQuery(line.data(), line.data() + line.size(), lineNumber);
+        } catch (const std::runtime_error& e) {
+            std::cerr << spotsPath << ":" << lineNumber << ": " << e.what() << std::endl;
+            return false;
+        }
+        int opponents = std::max(1, std::min(query.opponents, MAX_OPPONENTS));
+        search.reset(query.holeCards, query.communityCards, opponents);
+        std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(query.deadlineMs);
+        HandRank botRank;
+        HandRank opponentRank;
+        bool showdown;
+        long long iterations = 0;
+        while (iterations % TIME_CHECK_INTERVAL != 0 || std::chrono::steady_clock::now() < deadline) {
+            search.iterate(botRank, opponentRank, showdown);
+            iterations++;
+        }
         
-        // Determine winner
-        return game.isWinner();
+        int hero[2] = {query.holeCards[0].toInt(), query.holeCards[1].toInt()};
+        int board[5] = {0, 0, 0, 0, 0};
+        for (size_t i = 0; i < query.communityCards.size(); ++i) {
+            board[i] = query.communityCards[i].toInt();
+        }
+        int toCanonical[4];
+        unsigned long long key = canonicalSpotKey(hero, board, static_cast<int>(query.communityCards.size()),
+                                                  opponents, toCanonical);
+        std::vector<BookNode>& tree = trees[key];
+        tree.clear();
+        search.exportTree(toCanonical, BOOK_MIN_VISITS, tree);
+        std::cout << line << ": " << iterations << " iterations, " << search.nodeCount() << " nodes, "
+                  << tree.size() << " kept" << std::endl;
     }
     
-    // Get current win probability estimate
-    double getWinProbability() const {
-        return rootNode.getWinProbability();
+    std::vector<BookSpot> spots;
+    std::vector<BookNode> nodes;
+    for (std::map<unsigned long long, std::vector<BookNode> >::const_iterator it = trees.begin(); it != trees.end(); ++it) {
+        BookSpot spot = {it->first, static_cast<unsigned int>(nodes.size()), static_cast<unsigned int>(it->second.size())};
+        spots.push_back(spot);
+        nodes.insert(nodes.end(), it->second.begin(), it->second.end());
     }
-    
-    // Decide whether to fold or stay
-    bool shouldStay() const {
-        double winProbability = getWinProbability();
-        return winProbability >= WIN_PROBABILITY_THRESHOLD;
+    return OpeningBook::save(bookPath, search.model(), spots, nodes);
+}
+
+// Timings of one hot-path benchmark: nanoseconds per operation for each repeated run
+struct BenchmarkResult {
+    std::string name;
+    std::vector<double> samples;
+
+    double median() const {
+        std::vector<double> sorted(samples);
+        std::sort(sorted.begin(), sorted.end());
+        size_t n = sorted.size();
+        if (n == 0) return 0.0;
+        return n % 2 ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
     }
-    
-    // Print statistics
-    void printStats() const {
-        std::cout << "Simulations run: " << totalRuns << std::endl;
-        std::cout << "Wins: " << winningRuns << std::endl;
-        std::cout << "Win probability: " << std::fixed << std::setprecision(2) 
-                  << (getWinProbability() * 100.0) << "%" << std::endl;
-        std::cout << "Decision: " << (shouldStay() ? "STAY" : "FOLD") << std::endl;
+
+    // Median absolute deviation from the median
+    double mad() const {
+        BenchmarkResult deviations;
+        double center = median();
+        for (size_t i = 0; i < samples.size(); ++i) {
+            deviations.samples.push_back(std::fabs(samples[i] - center));
+        }
+        return deviations.median();
     }
 };
 
-// For testing purposes
-void testHandEvaluator() {
-    std::cout << "Testing Hand Evaluator..." << std::endl;
+// A benchmark body performs `ops` operations per call
+struct Benchmark {
+    std::string name;
+    int ops;
+    std::function<void()> body;
+
+    Benchmark(const std::string& benchmarkName, int operations, const std::function<void()>& benchmarkBody)
+        : name(benchmarkName), ops(operations), body(benchmarkBody) {}
+};
+
+// The simulation hot paths, each on a fixed spot with a fixed seed. After a warm-up call
+// each, the BENCH_REPETITIONS timed runs are interleaved round-robin across benchmarks so
+// a transient slowdown of the machine spreads over all of them instead of skewing one.
+std::vector<BenchmarkResult> runBenchmarks() {
+    std::srand(12345);
+    std::vector<Benchmark> benchmarks;
+    volatile long long sink = 0;
     
-    // Create test hands
-    Deck deck;
+    std::vector<Card> hole;
+    hole.push_back(Card(SPADES, ACE));
+    hole.push_back(Card(HEARTS, KING));
+    std::vector<Card> flop;
+    flop.push_back(Card(CLUBS, TWO));
+    flop.push_back(Card(HEARTS, SEVEN));
+    flop.push_back(Card(SPADES, QUEEN));
+    int hero[2] = {hole[0].toInt(), hole[1].toInt()};
     
-    // Royal Flush
-    std::vector<Card> royalFlush;
-    royalFlush.push_back(Card(HEARTS, ACE));
-    royalFlush.push_back(Card(HEARTS, KING));
-    royalFlush.push_back(Card(HEARTS, QUEEN));
-    royalFlush.push_back(Card(HEARTS, JACK));
-    royalFlush.push_back(Card(HEARTS, TEN));
-    royalFlush.push_back(Card(CLUBS, TWO));
-    royalFlush.push_back(Card(DIAMONDS, THREE));
+    // Random seven-card hands and five-card boards as suit masks
+    const int HANDS = 4096;
+    std::vector<int> handMasks(4 * HANDS, 0);
+    std::vector<int> boardMasks(4 * HANDS, 0);
+    for (int h = 0; h < HANDS; h++) {
+        Deck deck;
+        deck.shuffle();
+        for (int c = 0; c < 7; c++) {
+            int card = deck.deal().toInt();
+            handMasks[4 * h + card / 13] |= 1 << (card % 13);
+            if (c < 5) boardMasks[4 * h + card / 13] |= 1 << (card % 13);
+        }
+    }
     
-    // Straight Flush
-    std::vector<Card> straightFlush;
-    straightFlush.push_back(Card(SPADES, NINE));
-    straightFlush.push_back(Card(SPADES, EIGHT));
-    straightFlush.push_back(Card(SPADES, SEVEN));
-    straightFlush.push_back(Card(SPADES, SIX));
-    straightFlush.push_back(Card(SPADES, FIVE));
-    straightFlush.push_back(Card(CLUBS, TWO));
-    straightFlush.push_back(Card(DIAMONDS, THREE));
+    benchmarks.push_back(Benchmark("evaluate_masks", 200000, [&]() {
+        long long total = 0;
+        for (int n = 0; n < 200000; n++) {
+            total += HandEvaluator::evaluateMasks(&handMasks[4 * (n % HANDS)]);
+        }
+        sink = sink + total;
+    }));
+    benchmarks.push_back(Benchmark("board_texture", 200000, [&]() {
+        long long total = 0;
+        for (int n = 0; n < 200000; n++) {
+            BoardTexture texture = BoardTexture::fromMasks(&boardMasks[4 * (n % HANDS)]);
+            total += texture.nutClass + texture.connectedness;
+        }
+        sink = sink + total;
+    }));
     
-    // Four of a Kind
-    std::vector<Card> fourOfAKind;
-    fourOfAKind.push_back(Card(HEARTS, ACE));
-    fourOfAKind.push_back(Card(DIAMONDS, ACE));
-    fourOfAKind.push_back(Card(CLUBS, ACE));
-    fourOfAKind.push_back(Card(SPADES, ACE));
-    fourOfAKind.push_back(Card(HEARTS, KING));
-    fourOfAKind.push_back(Card(CLUBS, TWO));
-    fourOfAKind.push_back(Card(DIAMONDS, THREE));
+    PokerBot bot;
+    bot.setKnownCards(hole, flop);
+    benchmarks.push_back(Benchmark("game_simulation_flop", 20000, [&]() {
+        long long total = 0;
+        for (int n = 0; n < 20000; n++) {
+            total += bot.runSingleSimulation();
+        }
+        sink = sink + total;
+    }));
     
-    // Test each hand
-    HandEvaluation eval1 = HandEvaluator::evaluate(royalFlush);
-    HandEvaluation eval2 = HandEvaluator::evaluate(straightFlush);
-    HandEvaluation eval3 = HandEvaluator::evaluate(fourOfAKind);
+    BoardStrengthCache cache;
+    cache.prepare(hole, flop);
+    benchmarks.push_back(Benchmark("strength_table_flop", 200000, [&]() {
+        HandRank botRank;
+        HandRank opponentRank;
+        long long total = 0;
+        for (int n = 0; n < 200000; n++) {
+            total += cache.simulate(botRank, opponentRank);
+        }
+        sink = sink + total;
+    }));
     
-    // Print results
-    std::cout << "Royal Flush: " << HandEvaluator::handRankToString(eval1.rank) << std::endl;
-    std::cout << "Straight Flush: " << HandEvaluator::handRankToString(eval2.rank) << std::endl;
-    std::cout << "Four of a Kind: " << HandEvaluator::handRankToString(eval3.rank) << std::endl;
+    std::vector<int> board;
+    for (size_t i = 0; i < flop.size(); ++i) {
+        board.push_back(flop[i].toInt());
+    }
+    std::vector<int> live;
+    for (int card = 0; card < DECK_SIZE; card++) {
+        if (card != hero[0] && card != hero[1] && std::find(board.begin(), board.end(), card) == board.end()) {
+            live.push_back(card);
+        }
+    }
+    benchmarks.push_back(Benchmark("multiway_showdown_3way", 100000, [&]() {
+        double total = 0.0;
+        for (int n = 0; n < 100000; n++) {
+            total += simulateMultiwayShowdown(hero, board, live, 2, threadRandom());
+        }
+        sink = sink + static_cast<long long>(total);
+    }));
+    double contributions[3] = {10.0, 50.0, 100.0};
+    benchmarks.push_back(Benchmark("side_pot_payout_3way", 100000, [&]() {
+        double total = 0.0;
+        for (int n = 0; n < 100000; n++) {
+            total += simulateMultiwayPayout(hero, board, live, 2, contributions, threadRandom());
+        }
+        sink = sink + static_cast<long long>(total);
+    }));
     
-    // Test comparison
-    std::cout << "Royal Flush > Straight Flush: " << (eval1 > eval2 ? "Yes" : "No") << std::endl;
-    std::cout << "Straight Flush > Four of a Kind: " << (eval2 > eval3 ? "Yes" : "No") << std::endl;
+    InfoSetSearch search;
+    benchmarks.push_back(Benchmark("ismcts_iteration_flop", 100000, [&]() {
+        search.reset(hole, flop, 1);
+        HandRank botRank;
+        HandRank opponentRank;
+        bool showdown;
+        double total = 0.0;
+        for (int n = 0; n < 100000; n++) {
+            total += search.iterate(botRank, opponentRank, showdown);
+        }
+        sink = sink + static_cast<long long>(total);
+    }));
     
-    std::cout << "Hand Evaluator Tests Complete" << std::endl;
+    RolloutPolicy policy;
+    benchmarks.push_back(Benchmark("rollout_policy_sample", 200000, [&]() {
+        long long total = 0;
+        for (int n = 0; n < 200000; n++) {
+            total += policy.sample(n % POLICY_STRENGTH_BUCKETS, STREET_FLOP, 1);
+        }
+        sink = sink + total;
+    }));
+    
+    LeafEvaluator leaf;
+    int boardCards[5] = {board[0], board[1], board[2], 0, 0};
+    benchmarks.push_back(Benchmark("leaf_evaluation", 100000, [&]() {
+        float features[LEAF_FEATURES];
+        double total = 0.0;
+        for (int n = 0; n < 100000; n++) {
+            boardCards[2] = live[n % live.size()];
+            LeafEvaluator::features(hero, boardCards, 3, 1, DEFAULT_POT_ODDS, features);
+            total += leaf.evaluate(features);
+        }
+        sink = sink + static_cast<long long>(total);
+    }));
+    
+    std::vector<BenchmarkResult> results(benchmarks.size());
+    for (size_t b = 0; b < benchmarks.size(); ++b) {
+        results[b].name = benchmarks[b].name;
+        benchmarks[b].body();
+    }
+    for (int r = 0; r < BENCH_REPETITIONS; r++) {
+        for (size_t b = 0; b < benchmarks.size(); ++b) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            benchmarks[b].body();
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            results[b].samples.push_back(ns / benchmarks[b].ops);
+        }
+    }
+    return results;
 }
 
-// Parse a card string (e.g., "AS" for Ace of Spades)
-Card parseCard(const std::string& cardStr) {
-    if (cardStr.size() < 2) {
-        throw std::runtime_error("Invalid card format");
+// Results file: one line per benchmark, "<name> <runs> <ns per op>..."
+bool saveBenchmarkResults(const std::string& path, const std::vector<BenchmarkResult>& results) {
+    std::ofstream out(path.c_str());
+    out << std::setprecision(6);
+    for (size_t b = 0; b < results.size(); ++b) {
+        out << results[b].name << " " << results[b].samples.size();
+        for (size_t i = 0; i < results[b].samples.size(); ++i) {
+            out << " " << results[b].samples[i];
+        }
+        out << "\n";
     }
-    
-    // Parse value
-    Value value;
-    if (cardStr[0] == 'A') value = ACE;
-    else if (cardStr[0] == 'K') value = KING;
-    else if (cardStr[0] == 'Q') value = QUEEN;
-    else if (cardStr[0] == 'J') value = JACK;
-    else if (cardStr[0] == 'T' || cardStr[0] == '1') value = TEN;
-    else if (cardStr[0] >= '2' && cardStr[0] <= '9') {
-        value = static_cast<Value>(cardStr[0] - '0');
-    } else {
-        throw std::runtime_error("Invalid card value");
+    return static_cast<bool>(out);
+}
+
+bool loadBenchmarkResults(const std::string& path, std::vector<BenchmarkResult>& results) {
+    std::ifstream in(path.c_str());
+    if (!in) {
+        return false;
     }
-    
-    // Parse suit
-    Suit suit;
-    char suitChar = cardStr.back();
-    if (suitChar == 'C' || suitChar == 'c') suit = CLUBS;
-    else if (suitChar == 'D' || suitChar == 'd') suit = DIAMONDS;
-    else if (suitChar == 'H' || suitChar == 'h') suit = HEARTS;
-    else if (suitChar == 'S' || suitChar == 's') suit = SPADES;
-    else {
-        throw std::runtime_error("Invalid card suit");
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        BenchmarkResult result;
+        size_t runs = 0;
+        if (!(fields >> result.name >> runs)) continue;
+        double sample;
+        while (result.samples.size() < runs && fields >> sample) {
+            result.samples.push_back(sample);
+        }
+        results.push_back(result);
     }
+    return true;
+}
+
+// Two-sided p-value of the Mann-Whitney U test (normal approximation with tie correction)
+double mannWhitneyPValue(const std::vector<double>& a, const std::vector<double>& b) {
+    std::vector<std::pair<double, int> > pooled;
+    for (size_t i = 0; i < a.size(); ++i) pooled.push_back(std::make_pair(a[i], 0));
+    for (size_t i = 0; i < b.size(); ++i) pooled.push_back(std::make_pair(b[i], 1));
+    std::sort(pooled.begin(), pooled.end());
     
-    return Card(suit, value);
+    double n1 = static_cast<double>(a.size());
+    double n2 = static_cast<double>(b.size());
+    double n = n1 + n2;
+    double rankSum = 0.0;
+    double tieTerm = 0.0;
+    for (size_t i = 0; i < pooled.size();) {
+        size_t j = i;
+        while (j < pooled.size() && pooled[j].first == pooled[i].first) j++;
+        double rank = 0.5 * (i + 1 + j);   // average rank of the tied run
+        for (size_t k = i; k < j; ++k) {
+            if (pooled[k].second == 0) rankSum += rank;
+        }
+        double t = static_cast<double>(j - i);
+        tieTerm += t * t * t - t;
+        i = j;
+    }
+    double u = rankSum - n1 * (n1 + 1) / 2;
+    double variance = n1 * n2 / 12.0 * ((n + 1) - tieTerm / (n * (n - 1)));
+    if (variance <= 0) return 1.0;
+    double z = (u - n1 * n2 / 2) / std::sqrt(variance);
+    return std::erfc(std::fabs(z) / std::sqrt(2.0));
+}
+
+// Per-benchmark deltas against a baseline. A benchmark regresses when its median is more than
+// `thresholdPct` slower, the difference is significant and it clears the noise floor; returns
+// the number of regressions. The rank test only sees the spread within each process, so a
+// shift from one process to the next (frequency, layout, neighbours) looks significant; the
+// floor, BENCH_NOISE_MADS robust sigmas (1.4826 x MAD) of the two runs pooled, absorbs it.
+int compareBenchmarks(const std::vector<BenchmarkResult>& current, const std::vector<BenchmarkResult>& baseline,
+                      double thresholdPct) {
+    int regressions = 0;
+    std::cout << std::left << std::setw(26) << "benchmark" << std::right << std::setw(12) << "base ns"
+              << std::setw(12) << "now ns" << std::setw(10) << "delta" << std::setw(10) << "noise" << std::setw(10) << "p"
+              << "  verdict" << std::endl;
+    for (size_t c = 0; c < current.size(); ++c) {
+        const BenchmarkResult* base = NULL;
+        for (size_t b = 0; b < baseline.size(); ++b) {
+            if (baseline[b].name == current[c].name) base = &baseline[b];
+        }
+        if (base == NULL || base->samples.empty()) {
+            std::cout << std::left << std::setw(26) << current[c].name << std::right << "  (no baseline)" << std::endl;
+            continue;
+        }
+        double baseMedian = base->median();
+        double nowMedian = current[c].median();
+        double deltaPct = (nowMedian - baseMedian) / baseMedian * 100.0;
+        double pooledMad = std::sqrt(0.5 * (current[c].mad() * current[c].mad() + base->mad() * base->mad()));
+        double noisePct = BENCH_NOISE_MADS * 1.4826 * pooledMad / baseMedian * 100.0;
+        double p = mannWhitneyPValue(current[c].samples, base->samples);
+        const char* verdict = "same";
+        if (p < BENCH_SIGNIFICANCE && std::fabs(deltaPct) <= noisePct) {
+            verdict = "same (within noise)";
+        } else if (p < BENCH_SIGNIFICANCE) {
+            if (deltaPct > thresholdPct) {
+                verdict = "REGRESSION";
+                regressions++;
+            } else if (deltaPct > 0) {
+                verdict = "slower (under threshold)";
+            } else {
+                verdict = "faster";
+            }
+        }
+        std::cout << std::left << std::setw(26) << current[c].name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << baseMedian << std::setw(12) << nowMedian << std::setw(9) << std::showpos
+                  << deltaPct << std::noshowpos << "%" << std::setw(9) << noisePct << "%" << std::setprecision(4)
+                  << std::setw(10) << p << "  "
+                  << verdict << std::endl;
+    }
+    return regressions;
 }
 
 // Main function for running the bot
@@ -907,11 +6102,388 @@ int main(int argc, char* argv[]) {
     // Seed the random number generator
     std::srand(static_cast<unsigned int>(std::time(NULL)));
     
+    // Optional flags: --trace <file> writes a Chrome trace of every decision,
+    // --metrics <file> keeps a Prometheus text page up to date while running,
+    // --records <file> appends a JSONL cost record per decision,
+    // --validate-evaluator checks the fast evaluator on every 7-card hand and exits,
+    // --gen-preflop-matrix <file> writes the exact 169x169 preflop equity table and exits,
+    // --gen-multiway-table <file> writes preflop win probabilities against 1-8 opponents and exits
+    // (--samples sets the samples per entry), --opponents <n> and --multiway-table <file>
+    // make preflop decisions against n opponents from that table,
+    // --exact-equity <c1> <c2> <c3> <c4> prints exact all-in equity of c1 c2 against c3 c4 and exits,
+    // --batch <in> <out> answers one decision query per input line ("-" for stdin/stdout) and exits,
+    // --serve <socket> answers query lines from clients of a Unix socket until interrupted,
+    // --heatmap [board cards...] prints every starting hand's equity against a random hand and exits,
+    // --compare-holdings <n> <c1> <c2>... [board cards...] scores n holdings on shared runouts,
+    // prints each edge over the first with its variance against independent runs and exits,
+    // --ismcts searches the bot's later stay/fold decisions instead of sampling flat equity,
+    // --rollout-policy <pot odds> lets ISMCTS rollout opponents fold or continue at that price,
+    // --dump-leaf-samples <file> <n> writes n self-play leaf training samples and exits,
+    // --train-leaf <samples> <model> fits and quantizes the leaf evaluator and exits,
+    // --leaf-model <file> values new ISMCTS leaves with that model instead of rollouts,
+    // --allin-ev <c1> <c2> <stack> <stacks...> prints c1 c2's all-in EV with side pots against
+    // one random hand per opponent stack and exits,
+    // --increments <n> spends each decision's budget in n resumed runs, printing each estimate,
+    // --node-budget <n> caps the ISMCTS tree at n nodes, pruning its least-visited subtrees,
+    // --build-book <spots> <book> searches each spot (under the --rollout-policy, --leaf-model and
+    // --node-budget given anywhere) and writes the trees as an opening book and exits,
+    // --opening-book <file> seeds ISMCTS searches from that book (built under the same model),
+    // --bench times the hot paths (--bench-out <file> saves the runs, --bench-baseline <file>
+    // compares against saved runs and exits 2 on a regression past --bench-threshold <pct>)
+    std::string tracePath;
+    std::string metricsPath;
+    std::string recordsPath;
+    std::string multiwayPath;
+    std::string generateMultiwayPath;
+    int multiwaySamples = MULTIWAY_DEFAULT_SAMPLES;
+    int opponents = 1;
+    int metricsIntervalMs = METRICS_DEFAULT_INTERVAL_MS;
+    SearchMode searchMode = SEARCH_EQUITY;
+    double rolloutPotOdds = -1.0;
+    std::string leafSamplesPath;
+    int leafSampleCount = 0;
+    std::string leafModelPath;
+    int increments = 1;
+    long long nodeBudget = ISMCTS_MAX_NODES;
+    std::string bookPath;
+    std::string buildBookSpotsPath;
+    std::string buildBookPath;
+    std::string batchInputPath;
+    std::string batchOutputPath;
+    std::string servePath;
+    bool bench = false;
+    std::string benchOutPath;
+    std::string benchBaselinePath;
+    double benchThresholdPct = BENCH_DEFAULT_THRESHOLD_PCT;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--metrics" && i + 1 < argc) {
+            metricsPath = argv[++i];
+        } else if (arg == "--validate-evaluator") {
+            return validateEvaluator() ? 0 : 1;
+        } else if (arg == "--gen-preflop-matrix" && i + 1 < argc) {
+            std::string path = argv[++i];
+            if (!generatePreflopEquityTable(path)) {
+                std::cerr << "Error: could not write " << path << std::endl;
+                return 1;
+            }
+            return 0;
+        } else if (arg == "--gen-multiway-table" && i + 1 < argc) {
+            generateMultiwayPath = argv[++i];
+        } else if (arg == "--samples" && i + 1 < argc) {
+            multiwaySamples = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--multiway-table" && i + 1 < argc) {
+            multiwayPath = argv[++i];
+        } else if (arg == "--opponents" && i + 1 < argc) {
+            opponents = std::atoi(argv[++i]);
+        } else if (arg == "--exact-equity" && i + 4 < argc) {
+            std::vector<Card> hero;
+            std::vector<Card> villain;
+            try {
+                hero.push_back(parseCard(argv[i + 1]));
+                hero.push_back(parseCard(argv[i + 2]));
+                villain.push_back(parseCard(argv[i + 3]));
+                villain.push_back(parseCard(argv[i + 4]));
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                ShowdownTally tally = exactHeadsUpEquity(hero, villain);
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                std::cout << cardsToString(hero) << " vs " << cardsToString(villain) << ": "
+                          << std::fixed << std::setprecision(4) << (tally.equity() * 100.0) << "% equity ("
+                          << tally.wins << " wins, " << tally.ties << " ties, " << tally.total << " boards, "
+                          << std::setprecision(1) << ms << " ms)" << std::endl;
+            } catch (const std::runtime_error& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return 1;
+            }
+            return 0;
+        } else if (arg == "--batch" && i + 2 < argc) {
+            batchInputPath = argv[++i];
+            batchOutputPath = argv[++i];
+        } else if (arg == "--heatmap") {
+            std::vector<Card> board;
+            try {
+                while (i + 1 < argc && argv[i + 1][0] != '-') {
+                    board.push_back(parseCard(argv[++i]));
+                }
+                BoardHeatmap heatmap = computeBoardHeatmap(board, std::vector<double>(COMBO_COUNT, 1.0),
+                                                           HEATMAP_PREFLOP_SAMPLES);
+                std::cout << "Equity vs a random hand on [" << cardsToString(board) << "] ("
+                          << heatmap.runouts << " runouts)" << std::endl;
+                for (int row = 0; row < 13; row++) {
+                    for (int col = 0; col < 13; col++) {
+                        int handClass = row * 13 + col;
+                        std::cout << std::setw(4) << startingHandClassName(handClass) << " " << std::fixed
+                                  << std::setprecision(1) << std::setw(5) << (heatmap.classEquity[handClass] * 100.0);
+                    }
+                    std::cout << std::endl;
+                }
+            } catch (const std::runtime_error& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return 1;
+            }
+            return 0;
+        } else if (arg == "--serve" && i + 1 < argc) {
+            servePath = argv[++i];
+        } else if (arg == "--compare-holdings" && i + 1 < argc) {
+            int count = std::atoi(argv[++i]);
+            std::vector<std::vector<Card> > candidates;
+            std::vector<Card> board;
+            try {
+                for (int c = 0; c < count; c++) {
+                    if (i + 2 >= argc) {
+                        throw std::runtime_error("--compare-holdings expects two cards per holding");
+                    }
+                    std::vector<Card> holding;
+                    holding.push_back(parseCard(argv[++i]));
+                    holding.push_back(parseCard(argv[++i]));
+                    candidates.push_back(holding);
+                }
+                while (i + 1 < argc && argv[i + 1][0] != '-') {
+                    board.push_back(parseCard(argv[++i]));
+                }
+                printHoldingComparison(board, candidates);
+            } catch (const std::runtime_error& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return 1;
+            }
+            return 0;
+        } else if (arg == "--ismcts") {
+            searchMode = SEARCH_ISMCTS;
+        } else if (arg == "--rollout-policy" && i + 1 < argc) {
+            rolloutPotOdds = std::atof(argv[++i]);
+        } else if (arg == "--dump-leaf-samples" && i + 2 < argc) {
+            leafSamplesPath = argv[++i];
+            leafSampleCount = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--train-leaf" && i + 2 < argc) {
+            std::string samplesPath = argv[i + 1];
+            std::string modelPath = argv[i + 2];
+            if (!trainLeafEvaluator(samplesPath, modelPath)) {
+                std::cerr << "Error: could not train " << modelPath << " from " << samplesPath << std::endl;
+                return 1;
+            }
+            return 0;
+        } else if (arg == "--bench") {
+            bench = true;
+        } else if (arg == "--bench-out" && i + 1 < argc) {
+            benchOutPath = argv[++i];
+        } else if (arg == "--bench-baseline" && i + 1 < argc) {
+            benchBaselinePath = argv[++i];
+        } else if (arg == "--bench-threshold" && i + 1 < argc) {
+            benchThresholdPct = std::atof(argv[++i]);
+        } else if (arg == "--build-book" && i + 2 < argc) {
+            buildBookSpotsPath = argv[++i];
+            buildBookPath = argv[++i];
+        } else if (arg == "--opening-book" && i + 1 < argc) {
+            bookPath = argv[++i];
+        } else if (arg == "--node-budget" && i + 1 < argc) {
+            nodeBudget = std::atoll(argv[++i]);
+        } else if (arg == "--increments" && i + 1 < argc) {
+            increments = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--leaf-model" && i + 1 < argc) {
+            leafModelPath = argv[++i];
+        } else if (arg == "--allin-ev" && i + 4 < argc) {
+            try {
+                int hero[2] = {parseCard(argv[i + 1]).toInt(), parseCard(argv[i + 2]).toInt()};
+                std::vector<double> stacks;
+                // Every numeric argument is a stack, so a negative one is rejected rather than
+                // taken for the next flag
+                for (i += 3; i < argc; ++i) {
+                    char* end;
+                    double stack = std::strtod(argv[i], &end);
+                    if (end == argv[i] || *end != '\0') break;
+                    if (!(stack > 0.0) || std::isinf(stack)) {
+                        throw std::runtime_error(std::string("--allin-ev stacks must be positive and finite, got ") + argv[i]);
+                    }
+                    stacks.push_back(stack);
+                }
+                int players = static_cast<int>(stacks.size());
+                if (players < 2 || players > MAX_PLAYERS) {
+                    throw std::runtime_error("--allin-ev needs the hero's stack and 1-8 opponent stacks");
+                }
+                std::vector<int> board;
+                std::vector<int> live;
+                for (int card = 0; card < DECK_SIZE; card++) {
+                    if (card != hero[0] && card != hero[1]) live.push_back(card);
+                }
+                
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                double payout = 0.0;
+                for (int n = 0; n < ALLIN_EV_SAMPLES; n++) {
+                    payout += simulateMultiwayPayout(hero, board, live, players - 1, &stacks[0], threadRandom());
+                }
+                double evMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                start = std::chrono::steady_clock::now();
+                double share = 0.0;
+                for (int n = 0; n < ALLIN_EV_SAMPLES; n++) {
+                    share += simulateMultiwayShowdown(hero, board, live, players - 1, threadRandom());
+                }
+                double equityMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                payout /= ALLIN_EV_SAMPLES;
+                std::cout << std::fixed << std::setprecision(4) << "Expected payout " << payout << " (net "
+                          << (payout - stacks[0]) << ") over " << ALLIN_EV_SAMPLES << " showdowns in "
+                          << std::setprecision(1) << evMs << " ms; equity " << std::setprecision(4)
+                          << (share / ALLIN_EV_SAMPLES * 100.0) << "% in " << std::setprecision(1)
+                          << equityMs << " ms" << std::endl;
+            } catch (const std::runtime_error& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return 1;
+            }
+            return 0;
+        } else if (arg == "--records" && i + 1 < argc) {
+            recordsPath = argv[++i];
+        } else if (arg == "--metrics-interval-ms" && i + 1 < argc) {
+            metricsIntervalMs = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+    
+    if (bench) {
+        std::vector<BenchmarkResult> results = runBenchmarks();
+        for (size_t b = 0; b < results.size(); ++b) {
+            std::cout << std::left << std::setw(26) << results[b].name << std::right << std::fixed
+                      << std::setprecision(2) << std::setw(10) << results[b].median() << " ns/op  MAD "
+                      << results[b].mad() << " (" << results[b].samples.size() << " runs)" << std::endl;
+        }
+        if (!benchOutPath.empty() && !saveBenchmarkResults(benchOutPath, results)) {
+            std::cerr << "Error: could not write " << benchOutPath << std::endl;
+            return 1;
+        }
+        if (!benchBaselinePath.empty()) {
+            std::vector<BenchmarkResult> baseline;
+            if (!loadBenchmarkResults(benchBaselinePath, baseline)) {
+                std::cerr << "Error: could not read " << benchBaselinePath << std::endl;
+                return 1;
+            }
+            std::cout << std::endl;
+            if (compareBenchmarks(results, baseline, benchThresholdPct) > 0) {
+                return 2;
+            }
+        }
+        return 0;
+    }
+    
+    RolloutPolicy rolloutPolicy;
+    if (!leafSamplesPath.empty()) {
+        if (!dumpLeafSamples(leafSamplesPath, leafSampleCount, rolloutPotOdds >= 0.0 ? &rolloutPolicy : NULL)) {
+            std::cerr << "Error: could not write " << leafSamplesPath << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    
+    LeafEvaluator leafModel;
+    if (!leafModelPath.empty() && !leafModel.load(leafModelPath)) {
+        std::cerr << "Error: could not load leaf model " << leafModelPath << std::endl;
+        return 1;
+    }
+    
+    // Books are built after every flag is read, under the same model as live searches
+    if (!buildBookPath.empty()) {
+        if (!buildOpeningBook(buildBookSpotsPath, buildBookPath, rolloutPotOdds >= 0.0 ? &rolloutPolicy : NULL,
+                              rolloutPotOdds, leafModelPath.empty() ? NULL : &leafModel,
+                              static_cast<size_t>(std::max(0LL, nodeBudget)))) {
+            std::cerr << "Error: could not build " << buildBookPath << " from " << buildBookSpotsPath << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    
+    if (!generateMultiwayPath.empty()) {
+        if (!MultiwayEquityTable::generate(generateMultiwayPath, multiwaySamples)) {
+            std::cerr << "Error: could not write " << generateMultiwayPath << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    
+    if (!tracePath.empty()) {
+        Tracer::enable();
+    }
+    
+    MetricsExporter metricsExporter;
+    if (!metricsPath.empty()) {
+        metricsExporter.start(metricsPath, metricsIntervalMs);
+    }
+    
+    AsyncLineWriter recordWriter;
+    if (!recordsPath.empty() && !recordWriter.open(recordsPath)) {
+        std::cerr << "Error: could not open " << recordsPath << std::endl;
+        return 1;
+    }
+    
+    // Batch and server runs dispatch after every flag is read, so --metrics, --records and
+    // --trace cover them
+    if (!batchInputPath.empty() || !servePath.empty()) {
+        AsyncLineWriter* records = recordsPath.empty() ? NULL : &recordWriter;
+        bool ok = false;
+        if (!batchInputPath.empty()) {
+            ok = runBatch(batchInputPath, batchOutputPath, records);
+            if (!ok) {
+                std::cerr << "Error: batch run failed for " << batchInputPath << " -> " << batchOutputPath << std::endl;
+            }
+        } else {
+#ifdef POKERBOT_HAS_IO_URING
+            ok = runServer(servePath, records);
+            if (!ok) {
+                std::cerr << "Error: could not serve on " << servePath << std::endl;
+            }
+#else
+            std::cerr << "Error: --serve needs Linux io_uring" << std::endl;
+#endif
+        }
+        metricsExporter.stop();
+        recordWriter.close();
+        if (!tracePath.empty() && !Tracer::writeChromeTrace(tracePath)) {
+            std::cerr << "Error: could not write trace to " << tracePath << std::endl;
+            ok = false;
+        }
+        return ok ? 0 : 1;
+    }
+    
     // Uncomment to run hand evaluator tests
     // testHandEvaluator();
     
     // Create the poker bot
     PokerBot bot;
+    bot.setOpponentCount(opponents);
+    bot.setSearchMode(searchMode);
+    bot.setNodeBudget(static_cast<size_t>(std::max(0LL, nodeBudget)));
+    if (rolloutPotOdds >= 0.0) {
+        bot.setRolloutPolicy(&rolloutPolicy, rolloutPotOdds);
+    }
+    if (!leafModelPath.empty()) {
+        bot.setLeafEvaluator(&leafModel);
+    }
+    OpeningBook openingBook;
+    if (!bookPath.empty()) {
+        if (!openingBook.load(bookPath)) {
+            std::cerr << "Error: could not load opening book " << bookPath << std::endl;
+            return 1;
+        }
+        if (!(openingBook.getModel() == bot.getSearchModel())) {
+            std::cerr << "Error: opening book " << bookPath << " was built with a different --rollout-policy "
+                      << "or --leaf-model" << std::endl;
+            return 1;
+        }
+        bot.setOpeningBook(&openingBook);
+    }
+    
+    MultiwayEquityTable multiwayTable;
+    if (!multiwayPath.empty()) {
+        if (!multiwayTable.load(multiwayPath)) {
+            std::cerr << "Error: could not load multiway table " << multiwayPath << std::endl;
+            return 1;
+        }
+        bot.setMultiwayTable(&multiwayTable);
+    }
+    
+    if (!recordsPath.empty()) {
+        bot.setRecordWriter(&recordWriter);
+    }
     
     // Game phase tracking
     int phase = 0; // 0 = pre-flop, 1 = pre-turn, 2 = pre-river
@@ -931,6 +6503,7 @@ int main(int argc, char* argv[]) {
             std::string card1, card2;
             std::cin >> card1 >> card2;
             
+            TraceSpan intakeSpan("query intake");
             try {
                 holeCards.push_back(parseCard(card1));
                 holeCards.push_back(parseCard(card2));
@@ -952,6 +6525,7 @@ int main(int argc, char* argv[]) {
                 std::string card1, card2, card3;
                 std::cin >> card1 >> card2 >> card3;
                 
+                TraceSpan intakeSpan("query intake");
                 try {
                     communityCards.push_back(parseCard(card1));
                     communityCards.push_back(parseCard(card2));
@@ -970,6 +6544,7 @@ int main(int argc, char* argv[]) {
                 std::string turnCard;
                 std::cin >> turnCard;
                 
+                TraceSpan intakeSpan("query intake");
                 try {
                     communityCards.push_back(parseCard(turnCard));
                 } catch (const std::runtime_error& e) {
@@ -999,7 +6574,14 @@ int main(int argc, char* argv[]) {
         
         // Run MCTS simulations (10 seconds)
         std::cout << "\nRunning simulations (10 seconds)..." << std::endl;
-        bot.runMCTS(SIMULATION_TIME_LIMIT_MS);
+        for (int step = 0; step < increments; step++) {
+            bot.runMCTS(SIMULATION_TIME_LIMIT_MS / increments, step > 0);
+            if (increments > 1) {
+                std::cout << "  after " << bot.getLastDecisionRecord().totalSimulations << " simulations: "
+                          << std::fixed << std::setprecision(2) << (bot.getWinProbability() * 100.0) << "%"
+                          << std::endl;
+            }
+        }
         
         // Display stats and decision
         std::cout << "\nSimulation Results:" << std::endl;
@@ -1034,5 +6616,13 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    metricsExporter.stop();
+    recordWriter.close();
+    
+    if (!tracePath.empty() && !Tracer::writeChromeTrace(tracePath)) {
+        std::cerr << "Error: could not write trace to " << tracePath << std::endl;
+        return 1;
+    }
+    
     return 0;
 }